@@ -72,6 +72,30 @@ Landscape.cpp: Terrain rendering
 
 //@StarLight code - LandscapeGpuRender, Added by yanjianhong
 #include "LandscapeMobileGPURender.h"
+#include "LandscapeGpuVirtualHeightmap.h"
+#include "LandscapeGpuClusterQuadtree.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/CustomVersion.h"
+
+//Version of the GPU landscape data saved with ALandscapeProxy
+struct FLandscapeGpuRenderCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+		//The cluster bounds are saved as bulk min and max heights instead of tagged boxes
+		CompactClusterHeightRanges,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
+
+const FGuid FLandscapeGpuRenderCustomVersion::GUID(0x83DF0F30, 0x0CA2441A, 0xAAF3F7A6, 0xE6070D3C);
+static FCustomVersionRegistration GRegisterLandscapeGpuRenderCustomVersion(FLandscapeGpuRenderCustomVersion::GUID, FLandscapeGpuRenderCustomVersion::LatestVersion, TEXT("LandscapeGpuRender"));
 //@StarLight code - LandscapeGpuRender, Added by yanjianhong
 
 /** Landscape stats */
@@ -427,6 +451,7 @@ void ULandscapeComponent::Serialize(FArchive& Ar)
 		TArray<UTexture2D*> BackupWeightmapTextures;
 
 		//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+		//The GpuRender keeps the heightmap, its vertex factory decodes the height (RG) and the baked normal (BA) from one fetch
 		if (CVarMobileLandscapeGpuRender.GetValueOnAnyThread() == 0) {
 			Exchange(HeightmapTexture, BackupHeightmapTexture);
 		}
@@ -1096,6 +1121,9 @@ ALandscapeProxy::ALandscapeProxy(const FObjectInitializer& ObjectInitializer)
 	CollisionThickness = 16;
 	BodyInstance.SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
 	bGenerateOverlapEvents = false;
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	bDeferGpuRenderRegistration = false;
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 #if WITH_EDITORONLY_DATA
 	MaxPaintedLayersPerComponent = 0;
 	bHasLayersContent = false;
@@ -1947,9 +1975,44 @@ void ULandscapeComponent::SetWeightmapTexturesUsage(const TArray<ULandscapeWeigh
 
 #endif
 
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+void ALandscapeProxy::PreRegisterAllComponents()
+{
+	Super::PreRegisterAllComponents();
+	bDeferGpuRenderRegistration = true;
+}
+
+bool ALandscapeProxy::DeferGpuRenderRegistration(ULandscapeComponent* Component)
+{
+	if (!bDeferGpuRenderRegistration)
+	{
+		return false;
+	}
+	DeferredGpuRenderComponents.AddUnique(Component);
+	return true;
+}
+
+bool ALandscapeProxy::CancelDeferredGpuRenderRegistration(ULandscapeComponent* Component)
+{
+	return DeferredGpuRenderComponents.Remove(Component) > 0;
+}
+
+TArray<ULandscapeComponent*> ALandscapeProxy::TakeDeferredGpuRenderComponents()
+{
+	return MoveTemp(DeferredGpuRenderComponents);
+}
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+
 void ALandscapeProxy::PostRegisterAllComponents()
 {
 	Super::PostRegisterAllComponents();
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	if (bDeferGpuRenderRegistration)
+	{
+		bDeferGpuRenderRegistration = false;
+		FMobileLandscapeGPURenderSystem_GameThread::RegisterGPURenderLandscapeProxy(this);
+	}
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 	ULandscapeInfo* LandscapeInfo = nullptr;
 	if (!IsPendingKillPending())
 	{
@@ -2159,6 +2222,21 @@ void ALandscapeProxy::PreSave(const class ITargetPlatform* TargetPlatform)
 			Landscape->ClearDirtyData(LandscapeComponent);
 		}
 	}
+
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	//The cluster bounds are saved with the proxy, wait for the pending build
+	FinishClusterBoundingBoxBuild();
+
+	//The pages are saved with the proxy, drop the stale ones when the virtual heightmap is disabled
+	if (CVarMobileLandscapeVirtualHeightmap.GetValueOnGameThread() != 0 && LandscapeComponents.Num() > 0)
+	{
+		GetGpuVirtualHeightmap();
+	}
+	else
+	{
+		LandscapeGpuVirtualHeightmap = nullptr;
+	}
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 #endif // WITH_EDITOR
 }
 
@@ -2169,6 +2247,29 @@ void ALandscapeProxy::Serialize(FArchive& Ar)
 	Ar.UsingCustomVersion(FLandscapeCustomVersion::GUID);
 	Ar.UsingCustomVersion(FEditorObjectVersion::GUID);
 
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	Ar.UsingCustomVersion(FLandscapeGpuRenderCustomVersion::GUID);
+	if (Ar.CustomVer(FLandscapeGpuRenderCustomVersion::GUID) >= FLandscapeGpuRenderCustomVersion::CompactClusterHeightRanges)
+	{
+		//4 bytes per cluster, loaded with one memcpy
+		LandscapeClusterHeightRanges.BulkSerialize(Ar);
+	}
+#if WITH_EDITORONLY_DATA
+	else if (Ar.IsLoading())
+	{
+		LandscapeClusterHeightRanges.Reset(LandscapeClusterBoundingBox_DEPRECATED.Num());
+		for (const FBox& ClusterBox : LandscapeClusterBoundingBox_DEPRECATED)
+		{
+			//Floor the min and ceil the max, the converted range must still contain the cluster
+			const int32 MinHeight = FMath::Clamp(FMath::FloorToInt(LandscapeDataAccess::GetTexHeight(ClusterBox.Min.Z)), 0, 65535);
+			const int32 MaxHeight = FMath::Clamp(FMath::CeilToInt(LandscapeDataAccess::GetTexHeight(ClusterBox.Max.Z)), 0, 65535);
+			LandscapeClusterHeightRanges.Emplace(LandscapeGpuRenderParameter::PackClusterHeightRange(static_cast<uint16>(MinHeight), static_cast<uint16>(MaxHeight)));
+		}
+		LandscapeClusterBoundingBox_DEPRECATED.Empty();
+	}
+#endif
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+
 	if (Ar.IsLoading() && Ar.CustomVer(FLandscapeCustomVersion::GUID) < FLandscapeCustomVersion::MigrateOldPropertiesToNewRenderingProperties)
 	{
 		if (LODDistanceFactor_DEPRECATED > 0)
@@ -2580,92 +2681,271 @@ FIntRect ALandscapeProxy::GetBoundingRect() const
 //@StarLight code - END   Change Function Location, Merge All Component's Weightmap to One Weightmap, Added by zhuyule
 
 //@StarLight code - LandscapeGpuRender, Added by yanjianhong
-const TArray<FBox>& ALandscapeProxy::GetClusterBoundingBox(const FBox& ProxyLocalBox){
+namespace LandscapeClusterBounds {
+	//FColor is BGRA in memory, so the packed height R << 8 | G sits in bits 8-23 of each texel
+	FORCEINLINE VectorRegisterInt DecodeHeights(const FColor* Texels) {
+		return VectorIntAnd(VectorShiftRightImmLogical(VectorIntLoad(Texels), 8), MakeVectorRegisterInt(0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF));
+	}
+
+	//Min and max of the packed heights over a heightmap row, 16 texels per step and the last ones one by one
+	FORCEINLINE void AccumulateRowHeightRange(const FColor* Texels, uint32 NumTexels, VectorRegisterInt& InOutMin, VectorRegisterInt& InOutMax) {
+		uint32 TexelIndex = 0;
+		for (; TexelIndex + 16 <= NumTexels; TexelIndex += 16) {
+			const VectorRegisterInt Heights0 = DecodeHeights(Texels + TexelIndex);
+			const VectorRegisterInt Heights1 = DecodeHeights(Texels + TexelIndex + 4);
+			const VectorRegisterInt Heights2 = DecodeHeights(Texels + TexelIndex + 8);
+			const VectorRegisterInt Heights3 = DecodeHeights(Texels + TexelIndex + 12);
+			InOutMin = VectorIntMin(InOutMin, VectorIntMin(VectorIntMin(Heights0, Heights1), VectorIntMin(Heights2, Heights3)));
+			InOutMax = VectorIntMax(InOutMax, VectorIntMax(VectorIntMax(Heights0, Heights1), VectorIntMax(Heights2, Heights3)));
+		}
+		for (; TexelIndex < NumTexels; ++TexelIndex) {
+			const int32 Height = Texels[TexelIndex].R << 8u | Texels[TexelIndex].G;
+			const VectorRegisterInt Heights = VectorIntLoad1(&Height);
+			InOutMin = VectorIntMin(InOutMin, Heights);
+			InOutMax = VectorIntMax(InOutMax, Heights);
+		}
+	}
+
+	FORCEINLINE int32 ReduceMin(const VectorRegisterInt& Vector) {
+		int32 Lanes[4];
+		VectorIntStore(Vector, Lanes);
+		return FMath::Min(FMath::Min(Lanes[0], Lanes[1]), FMath::Min(Lanes[2], Lanes[3]));
+	}
+
+	FORCEINLINE int32 ReduceMax(const VectorRegisterInt& Vector) {
+		int32 Lanes[4];
+		VectorIntStore(Vector, Lanes);
+		return FMath::Max(FMath::Max(Lanes[0], Lanes[1]), FMath::Max(Lanes[2], Lanes[3]));
+	}
+
+	//Everything a worker needs for one component, the heightmaps are copied so the task never touches a UObject
+	struct FComponentInput {
+		const TArray<FColor>* HeightMapData;
+		uint32 HeightMapSizeX;
+		uint32 HeightmapOffsetX;
+		uint32 HeightmapOffsetY;
+		FIntPoint ComponentBase;
+		FIntPoint ComponentVertexBase;
+	};
+}
 
+void ALandscapeProxy::BuildClusterBoundingBoxAsync(const FBox& ProxyLocalBox, TUniqueFunction<void(const TArray<uint32>&)>&& OnBuilt) {
+	check(IsInGameThread());
 #if WITH_EDITOR
+	//One build at a time, the previous one may still be submitting its bounds
+	FinishClusterBoundingBoxBuild();
+
 	FVector BoundingSize = ProxyLocalBox.GetSize();
 	//The total section size of the landscape
 	const uint32 SectionSizeX = static_cast<uint32>(BoundingSize.X) / SubsectionSizeQuads;
 	const uint32 SectionSizeY = static_cast<uint32>(BoundingSize.Y) / SubsectionSizeQuads;
 	const uint32 LandscapeComponentSizeX = SectionSizeX / NumSubsections;
-	const uint32 LandscapeComponentSizeY = SectionSizeY / NumSubsections;
 	const uint32 SectionVerts = SubsectionSizeQuads + 1;
+	const uint32 SubsectionQuads = SubsectionSizeQuads;
+	const uint32 NumSections = NumSubsections;
 
 	//Cluster parameters
 	const uint32 ClusterSizePerSection = (SubsectionSizeQuads + 1) / LandscapeGpuRenderParameter::ClusterQuadSize;
 	const uint32 ClusterSizeX = ClusterSizePerSection * SectionSizeX;
 	const uint32 ClusterSizeY = ClusterSizePerSection * SectionSizeY;
 	const uint32 ClusterSizePerComponent = ClusterSizePerSection * NumSubsections;
-	const uint32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
 	check(SectionSizeX * SectionSizeY == LandscapeComponents.Num() * NumSubsections * NumSubsections);
 
-	//Get HeightMap 
-	uint32 HeightMapSizeX = SectionVerts * SectionSizeX;
-	uint32 HeightMapSizeY = SectionVerts * SectionSizeY;
-	UTexture2D* HeightmapTexture = LandscapeComponents[0]->GetHeightmap(); //All components are the same, so any one will do
-
+	//Get HeightMap, the components may use different heightmaps with the virtual heightmap
 	// The CPU must meet the following 3 conditions to read the texture before it can read the data from PlatformData
 	// Whether CompressionSettings is VectorDisplacementmap.
 	// Whether MipGenSettings is NoMipmaps.
 	// Whether SRGB is unchecked.
-	FColor* HeightMapData = reinterpret_cast<FColor*>(HeightmapTexture->Source.LockMip(0));
-	//Calculate the BoundingBox
-	//The vertices are exactly aligned to the power of 2, so there is no need to calculate whether they are on the edge or clamp
-	//The memory layout is unified for each Component linear arrangement
-	TArray<FBox> SubmitToRenderThreadBoundingBox;
-	SubmitToRenderThreadBoundingBox.Reserve(ClusterSizeX * ClusterSizeY);
-
-	for (uint32 CompoenntY = 0; CompoenntY < LandscapeComponentSizeY; ++CompoenntY) {
-		for (uint32 ComponentX = 0; ComponentX < LandscapeComponentSizeX; ++ComponentX) {
-			for (uint32 LocalClusterIndexY = 0; LocalClusterIndexY < ClusterSizePerComponent; ++LocalClusterIndexY) {
-				for (uint32 LocalClusterIndexX = 0; LocalClusterIndexX < ClusterSizePerComponent; ++LocalClusterIndexX) {
-					FIntPoint GlobalClusterIndex = FIntPoint(LocalClusterIndexX + ComponentX * ClusterSizePerComponent, LocalClusterIndexY + CompoenntY * ClusterSizePerComponent);
-					//FLandscapeGpuRenderProxyComponent_RenderThread::GetLinearIndexByClusterIndex(GlobalClusterIndex);
-					//Create Box
-					FVector VertexStartPos = FVector(
-						(GlobalClusterIndex.X & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + GlobalClusterIndex.X / ClusterSizePerSection * SubsectionSizeQuads,
-						(GlobalClusterIndex.Y & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + GlobalClusterIndex.Y / ClusterSizePerSection * SubsectionSizeQuads,
-						0.f
-					);
-
-					FVector VertexEndPos = FVector(
-						((GlobalClusterIndex.X + 1) & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + (GlobalClusterIndex.X + 1) / ClusterSizePerSection * SubsectionSizeQuads,
-						((GlobalClusterIndex.Y + 1) & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + (GlobalClusterIndex.Y + 1) / ClusterSizePerSection * SubsectionSizeQuads,
-						0.f
-					);
-
-					FBox& BoxRef = SubmitToRenderThreadBoundingBox.Emplace_GetRef(VertexStartPos, VertexEndPos);
-					BoxRef.Min.Z = 10000.f;
-					BoxRef.Max.Z = -10000.f;
-					bool bisFirst = true;
-					//Calculte Vertex
-					uint32 VertexSizeX = (GlobalClusterIndex.X & (ClusterSizePerSection - 1)) == 3 ? LandscapeGpuRenderParameter::ClusterQuadSize : LandscapeGpuRenderParameter::ClusterQuadSize + 1;
-					uint32 VertexSizeY = (GlobalClusterIndex.Y & (ClusterSizePerSection - 1)) == 3 ? LandscapeGpuRenderParameter::ClusterQuadSize : LandscapeGpuRenderParameter::ClusterQuadSize + 1;
-
-					for (uint32 VertexY = 0; VertexY < VertexSizeY; ++VertexY) {
-						for (uint32 VertexX = 0; VertexX < VertexSizeX; ++VertexX) {
-							//SampleIndex use VertSize instead of SectionQuadsize
-							uint32 SampleX = VertexX + (GlobalClusterIndex.X & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + GlobalClusterIndex.X / ClusterSizePerSection * SectionVerts;
-							uint32 SampleY = (VertexY + GlobalClusterIndex.Y * LandscapeGpuRenderParameter::ClusterQuadSize) * HeightMapSizeX;
-							uint32 HeightMapSampleIndex = SampleX + SampleY;
-							const auto& HeightValue = HeightMapData[HeightMapSampleIndex];
-							float VertexHeight = LandscapeDataAccess::GetLocalHeight(static_cast<uint16>(HeightValue.R << 8u | HeightValue.G));
-
-							//Update the Box
-							BoxRef.Min.Z = FMath::Min(BoxRef.Min.Z, VertexHeight);
-							BoxRef.Max.Z = FMath::Max(BoxRef.Max.Z, VertexHeight);
+	//The mips are copied and unlocked right away, only the copy goes to the workers
+	TMap<UTexture2D*, TSharedRef<TArray<FColor>, ESPMode::ThreadSafe>> HeightmapData;
+	TArray<LandscapeClusterBounds::FComponentInput> ComponentInputs;
+	ComponentInputs.Reserve(LandscapeComponents.Num());
+	for (const ULandscapeComponent* LandscapeComponent : LandscapeComponents) {
+		UTexture2D* HeightmapTexture = LandscapeComponent->GetHeightmap();
+		const uint32 HeightMapSizeX = HeightmapTexture->Source.GetSizeX();
+		const uint32 HeightMapSizeY = HeightmapTexture->Source.GetSizeY();
+		if (!HeightmapData.Contains(HeightmapTexture)) {
+			TSharedRef<TArray<FColor>, ESPMode::ThreadSafe> Texels = MakeShared<TArray<FColor>, ESPMode::ThreadSafe>();
+			Texels->Append(reinterpret_cast<const FColor*>(HeightmapTexture->Source.LockMip(0)), HeightMapSizeX * HeightMapSizeY);
+			HeightmapTexture->Source.UnlockMip(0);
+			HeightmapData.Add(HeightmapTexture, Texels);
+		}
+
+		LandscapeClusterBounds::FComponentInput& ComponentInput = ComponentInputs.AddDefaulted_GetRef();
+		ComponentInput.HeightMapData = &HeightmapData.FindChecked(HeightmapTexture).Get();
+		ComponentInput.HeightMapSizeX = HeightMapSizeX;
+		ComponentInput.HeightmapOffsetX = FMath::RoundToInt(LandscapeComponent->HeightmapScaleBias.Z * HeightMapSizeX);
+		ComponentInput.HeightmapOffsetY = FMath::RoundToInt(LandscapeComponent->HeightmapScaleBias.W * HeightMapSizeY);
+		ComponentInput.ComponentBase = LandscapeComponent->GetSectionBase() / ComponentSizeQuads;
+		ComponentInput.ComponentVertexBase = LandscapeComponent->GetSectionBase();
+	}
+	TArray<TSharedRef<TArray<FColor>, ESPMode::ThreadSafe>> HeightmapDataRefs;
+	HeightmapData.GenerateValueArray(HeightmapDataRefs);
+
+	//The vertex heights for the CPU queries
+	const FIntPoint HeightsSize = CVarMobileLandscapeClusterQuadtree.GetValueOnGameThread() != 0
+		? FIntPoint(SectionSizeX * SubsectionSizeQuads + 1, SectionSizeY * SubsectionSizeQuads + 1)
+		: FIntPoint::ZeroValue;
+	ClusterQuadtree.Reset();
+
+	ClusterBoundingBoxBuild = Async(EAsyncExecution::ThreadPool,
+		[HeightmapDataRefs = MoveTemp(HeightmapDataRefs), ComponentInputs = MoveTemp(ComponentInputs), OnBuilt = MoveTemp(OnBuilt), HeightsSize,
+		SectionVerts, SubsectionQuads, NumSections, LandscapeComponentSizeX, ClusterSizePerSection, ClusterSizePerComponent, ClusterSizeX, ClusterSizeY]() mutable {
+			FLandscapeClusterBoundsBuild Build;
+			Build.HeightsSize = HeightsSize;
+			Build.Heights.SetNumUninitialized(HeightsSize.X * HeightsSize.Y);
+			Build.HeightRanges.SetNumUninitialized(ClusterSizeX * ClusterSizeY);
+
+			//Calculate the BoundingBox, one component per task, each one writes its own clusters
+			//The vertices are exactly aligned to the power of 2, so there is no need to calculate whether they are on the edge or clamp
+			//The memory layout is unified for each Component linear arrangement
+			ParallelFor(ComponentInputs.Num(), [&](int32 ComponentIndex) {
+				const LandscapeClusterBounds::FComponentInput& ComponentInput = ComponentInputs[ComponentIndex];
+				const FColor* HeightMapData = ComponentInput.HeightMapData->GetData();
+				const uint32 StartIndex = (ComponentInput.ComponentBase.Y * LandscapeComponentSizeX + ComponentInput.ComponentBase.X) * ClusterSizePerComponent * ClusterSizePerComponent;
+
+				for (uint32 LocalClusterIndexY = 0; LocalClusterIndexY < ClusterSizePerComponent; ++LocalClusterIndexY) {
+					for (uint32 LocalClusterIndexX = 0; LocalClusterIndexX < ClusterSizePerComponent; ++LocalClusterIndexX) {
+						//Calculte Vertex, the last cluster of a section has one vertex less
+						uint32 VertexSizeX = (LocalClusterIndexX & (ClusterSizePerSection - 1)) == ClusterSizePerSection - 1 ? LandscapeGpuRenderParameter::ClusterQuadSize : LandscapeGpuRenderParameter::ClusterQuadSize + 1;
+						uint32 VertexSizeY = (LocalClusterIndexY & (ClusterSizePerSection - 1)) == ClusterSizePerSection - 1 ? LandscapeGpuRenderParameter::ClusterQuadSize : LandscapeGpuRenderParameter::ClusterQuadSize + 1;
+
+						//SampleIndex use VertSize instead of SectionQuadsize, relative to the component in its heightmap
+						//Only the min and max packed heights are kept, the X and Y of the box follow from the cluster grid
+						const uint32 SampleX = ComponentInput.HeightmapOffsetX + (LocalClusterIndexX & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + LocalClusterIndexX / ClusterSizePerSection * SectionVerts;
+						const uint32 SampleY = ComponentInput.HeightmapOffsetY + (LocalClusterIndexY & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize + LocalClusterIndexY / ClusterSizePerSection * SectionVerts;
+						VectorRegisterInt MinHeight = MakeVectorRegisterInt(MAX_uint16, MAX_uint16, MAX_uint16, MAX_uint16);
+						VectorRegisterInt MaxHeight = MakeVectorRegisterInt(0, 0, 0, 0);
+						for (uint32 VertexY = 0; VertexY < VertexSizeY; ++VertexY) {
+							LandscapeClusterBounds::AccumulateRowHeightRange(HeightMapData + (SampleY + VertexY) * ComponentInput.HeightMapSizeX + SampleX, VertexSizeX, MinHeight, MaxHeight);
+						}
+						Build.HeightRanges[StartIndex + LocalClusterIndexY * ClusterSizePerComponent + LocalClusterIndexX] = LandscapeGpuRenderParameter::PackClusterHeightRange(
+							static_cast<uint16>(LandscapeClusterBounds::ReduceMin(MinHeight)),
+							static_cast<uint16>(LandscapeClusterBounds::ReduceMax(MaxHeight))
+						);
+					}
+				}
+
+				//The sections share their border vertices, each one is written by the section after it, the landscape border by the last one
+				if (Build.Heights.Num() != 0) {
+					for (uint32 SubsectionY = 0; SubsectionY < NumSections; ++SubsectionY) {
+						for (uint32 SubsectionX = 0; SubsectionX < NumSections; ++SubsectionX) {
+							const uint32 FirstVertexX = ComponentInput.ComponentVertexBase.X + SubsectionX * SubsectionQuads;
+							const uint32 FirstVertexY = ComponentInput.ComponentVertexBase.Y + SubsectionY * SubsectionQuads;
+							const uint32 VertexSizeX = FirstVertexX + SectionVerts == static_cast<uint32>(HeightsSize.X) ? SectionVerts : SubsectionQuads;
+							const uint32 VertexSizeY = FirstVertexY + SectionVerts == static_cast<uint32>(HeightsSize.Y) ? SectionVerts : SubsectionQuads;
+							for (uint32 VertexY = 0; VertexY < VertexSizeY; ++VertexY) {
+								const FColor* HeightValues = HeightMapData + (ComponentInput.HeightmapOffsetY + SubsectionY * SectionVerts + VertexY) * ComponentInput.HeightMapSizeX + ComponentInput.HeightmapOffsetX + SubsectionX * SectionVerts;
+								uint16* Heights = Build.Heights.GetData() + (FirstVertexY + VertexY) * HeightsSize.X + FirstVertexX;
+								for (uint32 VertexX = 0; VertexX < VertexSizeX; ++VertexX) {
+									Heights[VertexX] = static_cast<uint16>(HeightValues[VertexX].R << 8u | HeightValues[VertexX].G);
+								}
+							}
 						}
 					}
 				}
+			});
+
+			OnBuilt(Build.HeightRanges);
+			return Build;
+		}
+	);
+#else
+	check(LandscapeClusterHeightRanges.Num() != 0);
+	OnBuilt(LandscapeClusterHeightRanges);
+#endif
+}
+
+void ALandscapeProxy::FinishClusterBoundingBoxBuild() {
+	check(IsInGameThread());
+	if (ClusterBoundingBoxBuild.IsValid()) {
+		FLandscapeClusterBoundsBuild Build = ClusterBoundingBoxBuild.Get();
+		ClusterBoundingBoxBuild.Reset();
+		LandscapeClusterHeightRanges = MoveTemp(Build.HeightRanges);
+		LandscapeClusterHeights = MoveTemp(Build.Heights);
+		LandscapeClusterHeightsSize = Build.HeightsSize;
+		check(LandscapeClusterHeightRanges.Num() != 0);
+	}
+}
+
+const TArray<uint8>& ALandscapeProxy::GetClusterHoleFlags(const FBox& ProxyLocalBox) {
+#if WITH_EDITOR
+	FVector BoundingSize = ProxyLocalBox.GetSize();
+	const uint32 SectionSizeX = static_cast<uint32>(BoundingSize.X) / SubsectionSizeQuads;
+	const uint32 SectionSizeY = static_cast<uint32>(BoundingSize.Y) / SubsectionSizeQuads;
+	const uint32 LandscapeComponentSizeX = SectionSizeX / NumSubsections;
+	const uint32 SectionVerts = SubsectionSizeQuads + 1;
+	const uint32 ComponentVerts = SectionVerts * NumSubsections;
+	const uint32 ClusterSizePerSection = SectionVerts / LandscapeGpuRenderParameter::ClusterQuadSize;
+	const uint32 ClusterSizePerComponent = ClusterSizePerSection * NumSubsections;
+	const uint32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
+
+	//Same threshold as the mesh holes of GeneratePlatformVertexData
+	const uint8 VisibilityThreshold = 170;
+	TArray<uint8> ClusterHoleFlags;
+	for (ULandscapeComponent* LandscapeComponent : LandscapeComponents) {
+		if (!LandscapeComponent->ComponentHasVisibilityPainted()) {
+			continue;
+		}
+		TArray<uint8> VisibilityData;
+		FLandscapeComponentDataInterface CDI(LandscapeComponent, 0);
+		CDI.GetWeightmapTextureData(ALandscapeProxy::VisibilityLayer, VisibilityData);
+		if (VisibilityData.Num() == 0) {
+			continue;
+		}
+		check(VisibilityData.Num() == ComponentVerts * ComponentVerts);
+		if (ClusterHoleFlags.Num() == 0) {
+			ClusterHoleFlags.AddZeroed(SectionSizeX * SectionSizeY * ClusterSizePerSection * ClusterSizePerSection);
+		}
+
+		const FIntPoint ComponentBase = LandscapeComponent->GetSectionBase() / ComponentSizeQuads;
+		const uint32 StartIndex = (ComponentBase.Y * LandscapeComponentSizeX + ComponentBase.X) * ClusterSqureSizePerComponent;
+		for (uint32 LocalClusterIndexY = 0; LocalClusterIndexY < ClusterSizePerComponent; ++LocalClusterIndexY) {
+			for (uint32 LocalClusterIndexX = 0; LocalClusterIndexX < ClusterSizePerComponent; ++LocalClusterIndexX) {
+				//Same vertices as the cluster bounds, the last cluster of a section has one vertex less
+				const uint32 VertexSizeX = (LocalClusterIndexX & (ClusterSizePerSection - 1)) == ClusterSizePerSection - 1 ? LandscapeGpuRenderParameter::ClusterQuadSize : LandscapeGpuRenderParameter::ClusterQuadSize + 1;
+				const uint32 VertexSizeY = (LocalClusterIndexY & (ClusterSizePerSection - 1)) == ClusterSizePerSection - 1 ? LandscapeGpuRenderParameter::ClusterQuadSize : LandscapeGpuRenderParameter::ClusterQuadSize + 1;
+				const uint32 FirstVertexX = LocalClusterIndexX / ClusterSizePerSection * SectionVerts + (LocalClusterIndexX & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize;
+				const uint32 FirstVertexY = LocalClusterIndexY / ClusterSizePerSection * SectionVerts + (LocalClusterIndexY & (ClusterSizePerSection - 1)) * LandscapeGpuRenderParameter::ClusterQuadSize;
+
+				uint32 NumHoleVertices = 0;
+				for (uint32 VertexY = 0; VertexY < VertexSizeY; ++VertexY) {
+					for (uint32 VertexX = 0; VertexX < VertexSizeX; ++VertexX) {
+						NumHoleVertices += VisibilityData[(FirstVertexY + VertexY) * ComponentVerts + FirstVertexX + VertexX] >= VisibilityThreshold ? 1 : 0;
+					}
+				}
+
+				uint8& HoleFlags = ClusterHoleFlags[StartIndex + LocalClusterIndexY * ClusterSizePerComponent + LocalClusterIndexX];
+				HoleFlags = NumHoleVertices == VertexSizeX * VertexSizeY ? LandscapeGpuRenderParameter::ClusterFullHoleFlag
+					: NumHoleVertices != 0 ? LandscapeGpuRenderParameter::ClusterPartialHoleFlag
+					: 0;
 			}
 		}
 	}
-	HeightmapTexture->Source.UnlockMip(0);
-	LandscapeClusterBoundingBox = MoveTemp(SubmitToRenderThreadBoundingBox);
+	LandscapeClusterHoleFlags = MoveTemp(ClusterHoleFlags);
 #endif
 
-	check(LandscapeClusterBoundingBox.Num() != 0);
-	return LandscapeClusterBoundingBox;
+	return LandscapeClusterHoleFlags;
+}
+
+ULandscapeGpuVirtualHeightmap* ALandscapeProxy::GetGpuVirtualHeightmap() {
+#if WITH_EDITOR
+	//Rebuilt every time like the cluster bounds, the heightmaps may have been edited
+	if (LandscapeGpuVirtualHeightmap == nullptr) {
+		LandscapeGpuVirtualHeightmap = NewObject<ULandscapeGpuVirtualHeightmap>(this, NAME_None);
+	}
+	LandscapeGpuVirtualHeightmap->BuildPages(this);
+#endif
+	return LandscapeGpuVirtualHeightmap;
+}
+
+TSharedPtr<const FLandscapeGpuClusterQuadtree> ALandscapeProxy::GetClusterQuadtree() {
+	check(IsInGameThread());
+	FinishClusterBoundingBoxBuild();
+	if (!ClusterQuadtree.IsValid() && LandscapeClusterHeights.Num() != 0 && LandscapeClusterHeightRanges.Num() != 0) {
+		ClusterQuadtree = MakeShared<const FLandscapeGpuClusterQuadtree>(this);
+	}
+	return ClusterQuadtree;
 }
 //@StarLight code - LandscapeGpuRender, Added by yanjianhong
 
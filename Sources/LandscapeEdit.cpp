@@ -6193,6 +6193,10 @@ void ULandscapeComponent::GenerateMobileWeightmapLayerAllocations()
 {
 	TSet<FName> LayerNames;
 	GetAllMobileRelevantLayerNames(LayerNames, GetLandscapeMaterial()->GetMaterial());
+
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	WholeWeightmapLayerNames = LayerNames.Array(); //Same order as the channels below
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 	MobileWeightmapLayerAllocations = WeightmapLayerAllocations.FilterByPredicate([&](const FWeightmapLayerAllocationInfo& Allocation) -> bool 
 		{
 			return Allocation.LayerInfo && LayerNames.Contains(Allocation.LayerInfo == ALandscapeProxy::VisibilityLayer ? UMaterialExpressionLandscapeVisibilityMask::ParameterName : Allocation.GetLayerName());
@@ -0,0 +1,330 @@
+#include "LandscapeGpuClusterQuadtree.h"
+#include "LandscapeProxy.h"
+#include "LandscapeDataAccess.h"
+#include "LandscapeMobileGPURenderEngine.h"
+#include "Algo/Sort.h"
+
+namespace {
+	//Replaces 1/0 in the slab tests, keeps the products finite
+	constexpr float LargeInverse = 1e30f;
+
+	//A ray node of the traversal, the time range is where the ray is inside the cell box
+	struct FTraversalNode {
+		int32 Level;
+		int32 CellX;
+		int32 CellY;
+		float TimeEnter;
+		float TimeExit;
+	};
+
+	inline float GetSafeInverse(float Value) {
+		return FMath::Abs(Value) > SMALL_NUMBER ? 1.f / Value : (Value >= 0.f ? LargeInverse : -LargeInverse);
+	}
+
+	//Moller-Trumbore, Delta is the whole segment so the time is in [0, 1] along it
+	inline bool IntersectTriangle(const FVector& Start, const FVector& Delta, const FVector& V0, const FVector& V1, const FVector& V2, float& OutTime) {
+		const FVector Edge1 = V1 - V0;
+		const FVector Edge2 = V2 - V0;
+		const FVector P = FVector::CrossProduct(Delta, Edge2);
+		const float Determinant = FVector::DotProduct(Edge1, P);
+		if (FMath::Abs(Determinant) < SMALL_NUMBER) {
+			return false;
+		}
+		const float InvDeterminant = 1.f / Determinant;
+		const FVector T = Start - V0;
+		const float U = FVector::DotProduct(T, P) * InvDeterminant;
+		if (U < -KINDA_SMALL_NUMBER || U > 1.f + KINDA_SMALL_NUMBER) {
+			return false;
+		}
+		const FVector Q = FVector::CrossProduct(T, Edge1);
+		const float V = FVector::DotProduct(Delta, Q) * InvDeterminant;
+		if (V < -KINDA_SMALL_NUMBER || U + V > 1.f + KINDA_SMALL_NUMBER) {
+			return false;
+		}
+		OutTime = FVector::DotProduct(Edge2, Q) * InvDeterminant;
+		return true;
+	}
+}
+
+FLandscapeGpuClusterQuadtree::FLandscapeGpuClusterQuadtree(const ALandscapeProxy* LandscapeProxy)
+	: Heights(LandscapeProxy->LandscapeClusterHeights)
+	, NumVerts(LandscapeProxy->LandscapeClusterHeightsSize)
+	, NumClusters(0, 0)
+	, ClusterSizePerSection((LandscapeProxy->SubsectionSizeQuads + 1) / LandscapeGpuRenderParameter::ClusterQuadSize)
+	, SectionSizeQuads(LandscapeProxy->SubsectionSizeQuads)
+	, LocalToWorld(LandscapeProxy->GetRootComponent()->GetComponentTransform())
+{
+	const TArray<uint32>& ClusterHeightRanges = LandscapeProxy->LandscapeClusterHeightRanges;
+	const TArray<uint8>& ClusterHoleFlags = LandscapeProxy->LandscapeClusterHoleFlags;
+	if (Heights.Num() == 0 || Heights.Num() != NumVerts.X * NumVerts.Y || ClusterHeightRanges.Num() == 0) {
+		Heights.Empty();
+		return;
+	}
+
+	//The clusters are stored component by component, see ALandscapeProxy::BuildClusterBoundingBoxAsync
+	NumClusters = (NumVerts - FIntPoint(1, 1)) / SectionSizeQuads * ClusterSizePerSection;
+	check(ClusterHeightRanges.Num() == NumClusters.X * NumClusters.Y);
+	const int32 ClusterSizePerComponent = ClusterSizePerSection * LandscapeProxy->NumSubsections;
+	const int32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
+	const int32 LandscapeComponentSizeX = NumClusters.X / ClusterSizePerComponent;
+
+	FLevel& ClusterLevel = Levels.AddDefaulted_GetRef();
+	ClusterLevel.Size = NumClusters;
+	ClusterLevel.MinZ.SetNumUninitialized(NumClusters.X * NumClusters.Y);
+	ClusterLevel.MaxZ.SetNumUninitialized(NumClusters.X * NumClusters.Y);
+	for (int32 ClusterY = 0; ClusterY < NumClusters.Y; ++ClusterY) {
+		for (int32 ClusterX = 0; ClusterX < NumClusters.X; ++ClusterX) {
+			const int32 LinearIndex = ((ClusterY / ClusterSizePerComponent) * LandscapeComponentSizeX + ClusterX / ClusterSizePerComponent) * ClusterSqureSizePerComponent
+				+ (ClusterY % ClusterSizePerComponent) * ClusterSizePerComponent + ClusterX % ClusterSizePerComponent;
+			const bool bFullHole = ClusterHoleFlags.Num() > 0 && (ClusterHoleFlags[LinearIndex] & LandscapeGpuRenderParameter::ClusterFullHoleFlag) != 0;
+			const int32 CellIndex = ClusterY * NumClusters.X + ClusterX;
+			ClusterLevel.MinZ[CellIndex] = bFullHole ? MAX_flt : LandscapeDataAccess::GetLocalHeight(static_cast<uint16>(ClusterHeightRanges[LinearIndex] & 0xFFFF));
+			ClusterLevel.MaxZ[CellIndex] = bFullHole ? -MAX_flt : LandscapeDataAccess::GetLocalHeight(static_cast<uint16>(ClusterHeightRanges[LinearIndex] >> 16));
+		}
+	}
+
+	//Reduce until the root covers the whole landscape
+	while (Levels.Last().Size.X > 1 || Levels.Last().Size.Y > 1) {
+		const int32 ChildLevelIndex = Levels.Num() - 1;
+		FLevel& Level = Levels.AddDefaulted_GetRef();
+		const FLevel& ChildLevel = Levels[ChildLevelIndex];
+		Level.Size = FIntPoint(FMath::DivideAndRoundUp(ChildLevel.Size.X, 2), FMath::DivideAndRoundUp(ChildLevel.Size.Y, 2));
+		Level.MinZ.Init(MAX_flt, Level.Size.X * Level.Size.Y);
+		Level.MaxZ.Init(-MAX_flt, Level.Size.X * Level.Size.Y);
+		for (int32 ChildY = 0; ChildY < ChildLevel.Size.Y; ++ChildY) {
+			for (int32 ChildX = 0; ChildX < ChildLevel.Size.X; ++ChildX) {
+				const int32 CellIndex = (ChildY / 2) * Level.Size.X + ChildX / 2;
+				const int32 ChildIndex = ChildY * ChildLevel.Size.X + ChildX;
+				Level.MinZ[CellIndex] = FMath::Min(Level.MinZ[CellIndex], ChildLevel.MinZ[ChildIndex]);
+				Level.MaxZ[CellIndex] = FMath::Max(Level.MaxZ[CellIndex], ChildLevel.MaxZ[ChildIndex]);
+			}
+		}
+	}
+}
+
+float FLandscapeGpuClusterQuadtree::GetVertexHeight(int32 VertexX, int32 VertexY) const {
+	return LandscapeDataAccess::GetLocalHeight(Heights[VertexY * NumVerts.X + VertexX]);
+}
+
+int32 FLandscapeGpuClusterQuadtree::GetClusterFirstQuad(int32 ClusterIndex) const {
+	//The last cluster of a section is one quad short
+	return (ClusterIndex % ClusterSizePerSection) * LandscapeGpuRenderParameter::ClusterQuadSize + (ClusterIndex / ClusterSizePerSection) * SectionSizeQuads;
+}
+
+void FLandscapeGpuClusterQuadtree::GetCellQuads(int32 Level, int32 CellX, int32 CellY, FIntPoint& OutMin, FIntPoint& OutMax) const {
+	OutMin = FIntPoint(GetClusterFirstQuad(CellX << Level), GetClusterFirstQuad(CellY << Level));
+	OutMax = FIntPoint(GetClusterFirstQuad(FMath::Min((CellX + 1) << Level, NumClusters.X)), GetClusterFirstQuad(FMath::Min((CellY + 1) << Level, NumClusters.Y)));
+}
+
+bool FLandscapeGpuClusterQuadtree::GetLocalHeight(float LocalX, float LocalY, float& OutHeight) const {
+	if (!IsValid() || LocalX < 0.f || LocalY < 0.f || LocalX > NumVerts.X - 1 || LocalY > NumVerts.Y - 1) {
+		return false;
+	}
+
+	//The clusters entirely in a hole have no surface
+	const int32 QuadX = FMath::Min(FMath::FloorToInt(LocalX), NumVerts.X - 2);
+	const int32 QuadY = FMath::Min(FMath::FloorToInt(LocalY), NumVerts.Y - 2);
+	const int32 ClusterX = FMath::Min(QuadX / SectionSizeQuads * ClusterSizePerSection + FMath::Min((QuadX % SectionSizeQuads) / LandscapeGpuRenderParameter::ClusterQuadSize, ClusterSizePerSection - 1), NumClusters.X - 1);
+	const int32 ClusterY = FMath::Min(QuadY / SectionSizeQuads * ClusterSizePerSection + FMath::Min((QuadY % SectionSizeQuads) / LandscapeGpuRenderParameter::ClusterQuadSize, ClusterSizePerSection - 1), NumClusters.Y - 1);
+	const FLevel& ClusterLevel = Levels[0];
+	if (ClusterLevel.MinZ[ClusterY * NumClusters.X + ClusterX] > ClusterLevel.MaxZ[ClusterY * NumClusters.X + ClusterX]) {
+		return false;
+	}
+
+	//Same triangles as the cluster index buffer, the diagonal goes from (0, 0) to (1, 1)
+	const float FractionX = LocalX - QuadX;
+	const float FractionY = LocalY - QuadY;
+	const float Height00 = GetVertexHeight(QuadX, QuadY);
+	const float Height11 = GetVertexHeight(QuadX + 1, QuadY + 1);
+	if (FractionX >= FractionY) {
+		const float Height10 = GetVertexHeight(QuadX + 1, QuadY);
+		OutHeight = Height00 + FractionX * (Height10 - Height00) + FractionY * (Height11 - Height10);
+	}
+	else {
+		const float Height01 = GetVertexHeight(QuadX, QuadY + 1);
+		OutHeight = Height00 + FractionY * (Height01 - Height00) + FractionX * (Height11 - Height01);
+	}
+	return true;
+}
+
+bool FLandscapeGpuClusterQuadtree::RaycastCluster(int32 ClusterX, int32 ClusterY, const FVector& Start, const FVector& Delta, float TimeEnter, float TimeExit, float& OutTime) const {
+	FIntPoint QuadMin, QuadMax;
+	GetCellQuads(0, ClusterX, ClusterY, QuadMin, QuadMax);
+
+	//Walk the quads the ray crosses inside the cluster, the first hit is the nearest
+	const FVector EnterPosition = Start + Delta * TimeEnter;
+	int32 QuadX = FMath::Clamp(FMath::FloorToInt(EnterPosition.X), QuadMin.X, QuadMax.X - 1);
+	int32 QuadY = FMath::Clamp(FMath::FloorToInt(EnterPosition.Y), QuadMin.Y, QuadMax.Y - 1);
+	const int32 StepX = Delta.X >= 0.f ? 1 : -1;
+	const int32 StepY = Delta.Y >= 0.f ? 1 : -1;
+	const float InvDeltaX = GetSafeInverse(Delta.X);
+	const float InvDeltaY = GetSafeInverse(Delta.Y);
+	const float TimeDeltaX = FMath::Abs(InvDeltaX);
+	const float TimeDeltaY = FMath::Abs(InvDeltaY);
+	float TimeMaxX = (QuadX + (StepX > 0 ? 1 : 0) - Start.X) * InvDeltaX;
+	float TimeMaxY = (QuadY + (StepY > 0 ? 1 : 0) - Start.Y) * InvDeltaY;
+
+	while (QuadX >= QuadMin.X && QuadX < QuadMax.X && QuadY >= QuadMin.Y && QuadY < QuadMax.Y) {
+		const FVector V00(QuadX, QuadY, GetVertexHeight(QuadX, QuadY));
+		const FVector V10(QuadX + 1, QuadY, GetVertexHeight(QuadX + 1, QuadY));
+		const FVector V01(QuadX, QuadY + 1, GetVertexHeight(QuadX, QuadY + 1));
+		const FVector V11(QuadX + 1, QuadY + 1, GetVertexHeight(QuadX + 1, QuadY + 1));
+		float HitTime = MAX_flt;
+		float TriangleTime;
+		if (IntersectTriangle(Start, Delta, V00, V11, V10, TriangleTime) && TriangleTime >= TimeEnter - KINDA_SMALL_NUMBER && TriangleTime <= TimeExit + KINDA_SMALL_NUMBER) {
+			HitTime = TriangleTime;
+		}
+		if (IntersectTriangle(Start, Delta, V00, V01, V11, TriangleTime) && TriangleTime >= TimeEnter - KINDA_SMALL_NUMBER && TriangleTime <= TimeExit + KINDA_SMALL_NUMBER) {
+			HitTime = FMath::Min(HitTime, TriangleTime);
+		}
+		if (HitTime != MAX_flt) {
+			OutTime = FMath::Clamp(HitTime, 0.f, 1.f);
+			return true;
+		}
+
+		const float TimeNext = FMath::Min(TimeMaxX, TimeMaxY);
+		if (TimeNext > TimeExit) {
+			break;
+		}
+		if (TimeMaxX < TimeMaxY) {
+			QuadX += StepX;
+			TimeMaxX += TimeDeltaX;
+		}
+		else {
+			QuadY += StepY;
+			TimeMaxY += TimeDeltaY;
+		}
+	}
+	return false;
+}
+
+bool FLandscapeGpuClusterQuadtree::RaycastLocal(const FVector& Start, const FVector& Delta, float& OutTime) const {
+	if (!IsValid()) {
+		return false;
+	}
+
+	const VectorRegister StartX = VectorSetFloat1(Start.X);
+	const VectorRegister StartY = VectorSetFloat1(Start.Y);
+	const VectorRegister StartZ = VectorSetFloat1(Start.Z);
+	const VectorRegister InvDeltaX = VectorSetFloat1(GetSafeInverse(Delta.X));
+	const VectorRegister InvDeltaY = VectorSetFloat1(GetSafeInverse(Delta.Y));
+	const VectorRegister InvDeltaZ = VectorSetFloat1(GetSafeInverse(Delta.Z));
+	const VectorRegister SegmentMin = VectorZero();
+	const VectorRegister SegmentMax = VectorOne();
+
+	TArray<FTraversalNode, TInlineAllocator<64>> NodeStack;
+	NodeStack.Add({ Levels.Num(), 0, 0, 0.f, 1.f }); //Virtual parent of the root
+	while (NodeStack.Num() > 0) {
+		const FTraversalNode Node = NodeStack.Pop(false);
+		if (Node.Level == 0) {
+			if (RaycastCluster(Node.CellX, Node.CellY, Start, Delta, Node.TimeEnter, Node.TimeExit, OutTime)) {
+				return true;
+			}
+			continue;
+		}
+
+		//Test the 4 children at once, the ones outside the level are empty boxes
+		const int32 ChildLevelIndex = Node.Level - 1;
+		const FLevel& ChildLevel = Levels[ChildLevelIndex];
+		const int32 ChildCount = Node.Level == Levels.Num() ? 1 : 4;
+		MS_ALIGN(16) float ChildBounds[6][4] GCC_ALIGN(16);
+		for (int32 Child = 0; Child < 4; ++Child) {
+			const int32 ChildX = Node.CellX * 2 + (Child & 1);
+			const int32 ChildY = Node.CellY * 2 + (Child >> 1);
+			if (Child < ChildCount && ChildX < ChildLevel.Size.X && ChildY < ChildLevel.Size.Y) {
+				FIntPoint QuadMin, QuadMax;
+				GetCellQuads(ChildLevelIndex, ChildX, ChildY, QuadMin, QuadMax);
+				ChildBounds[0][Child] = QuadMin.X;
+				ChildBounds[1][Child] = QuadMax.X;
+				ChildBounds[2][Child] = QuadMin.Y;
+				ChildBounds[3][Child] = QuadMax.Y;
+				ChildBounds[4][Child] = ChildLevel.MinZ[ChildY * ChildLevel.Size.X + ChildX];
+				ChildBounds[5][Child] = ChildLevel.MaxZ[ChildY * ChildLevel.Size.X + ChildX];
+			}
+			else {
+				ChildBounds[0][Child] = ChildBounds[2][Child] = ChildBounds[4][Child] = 0.f;
+				ChildBounds[1][Child] = ChildBounds[3][Child] = ChildBounds[5][Child] = -1.f;
+			}
+		}
+
+		const VectorRegister TimeX0 = VectorMultiply(VectorSubtract(VectorLoadAligned(ChildBounds[0]), StartX), InvDeltaX);
+		const VectorRegister TimeX1 = VectorMultiply(VectorSubtract(VectorLoadAligned(ChildBounds[1]), StartX), InvDeltaX);
+		const VectorRegister TimeY0 = VectorMultiply(VectorSubtract(VectorLoadAligned(ChildBounds[2]), StartY), InvDeltaY);
+		const VectorRegister TimeY1 = VectorMultiply(VectorSubtract(VectorLoadAligned(ChildBounds[3]), StartY), InvDeltaY);
+		const VectorRegister TimeZ0 = VectorMultiply(VectorSubtract(VectorLoadAligned(ChildBounds[4]), StartZ), InvDeltaZ);
+		const VectorRegister TimeZ1 = VectorMultiply(VectorSubtract(VectorLoadAligned(ChildBounds[5]), StartZ), InvDeltaZ);
+		const VectorRegister TimeEnter = VectorMax(VectorMax(VectorMin(TimeX0, TimeX1), VectorMin(TimeY0, TimeY1)), VectorMax(VectorMin(TimeZ0, TimeZ1), SegmentMin));
+		const VectorRegister TimeExit = VectorMin(VectorMin(VectorMax(TimeX0, TimeX1), VectorMax(TimeY0, TimeY1)), VectorMin(VectorMax(TimeZ0, TimeZ1), SegmentMax));
+		const VectorRegister NonEmpty = VectorBitwiseAnd(VectorBitwiseAnd(VectorCompareLE(VectorLoadAligned(ChildBounds[0]), VectorLoadAligned(ChildBounds[1])), VectorCompareLE(VectorLoadAligned(ChildBounds[2]), VectorLoadAligned(ChildBounds[3]))), VectorCompareLE(VectorLoadAligned(ChildBounds[4]), VectorLoadAligned(ChildBounds[5])));
+		const int32 HitMask = VectorMaskBits(VectorBitwiseAnd(VectorCompareLE(TimeEnter, TimeExit), NonEmpty));
+		if (HitMask == 0) {
+			continue;
+		}
+
+		MS_ALIGN(16) float ChildTimeEnter[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float ChildTimeExit[4] GCC_ALIGN(16);
+		VectorStoreAligned(TimeEnter, ChildTimeEnter);
+		VectorStoreAligned(TimeExit, ChildTimeExit);
+
+		//The cells do not overlap, so visiting the children front to back makes the first hit the nearest
+		int32 HitChildren[4];
+		int32 NumHitChildren = 0;
+		for (int32 Child = 0; Child < 4; ++Child) {
+			if (HitMask & (1 << Child)) {
+				HitChildren[NumHitChildren++] = Child;
+			}
+		}
+		Algo::Sort(MakeArrayView(HitChildren, NumHitChildren), [&ChildTimeEnter](int32 A, int32 B) { return ChildTimeEnter[A] > ChildTimeEnter[B]; });
+		for (int32 HitIndex = 0; HitIndex < NumHitChildren; ++HitIndex) {
+			const int32 Child = HitChildren[HitIndex];
+			NodeStack.Add({ ChildLevelIndex, Node.CellX * 2 + (Child & 1), Node.CellY * 2 + (Child >> 1), ChildTimeEnter[Child], ChildTimeExit[Child] });
+		}
+	}
+	return false;
+}
+
+bool FLandscapeGpuClusterQuadtree::GetHeight(const FVector2D& WorldPosition, float& OutHeight) const {
+	const FVector LocalPosition = LocalToWorld.InverseTransformPosition(FVector(WorldPosition, 0.f));
+	float LocalHeight;
+	if (!GetLocalHeight(LocalPosition.X, LocalPosition.Y, LocalHeight)) {
+		return false;
+	}
+	OutHeight = LocalToWorld.TransformPosition(FVector(LocalPosition.X, LocalPosition.Y, LocalHeight)).Z;
+	return true;
+}
+
+bool FLandscapeGpuClusterQuadtree::Raycast(const FVector& WorldStart, const FVector& WorldEnd, FVector& OutWorldHit) const {
+	//The transform is affine, so the hit time is the same in both spaces
+	const FVector LocalStart = LocalToWorld.InverseTransformPosition(WorldStart);
+	const FVector LocalEnd = LocalToWorld.InverseTransformPosition(WorldEnd);
+	float HitTime;
+	if (!RaycastLocal(LocalStart, LocalEnd - LocalStart, HitTime)) {
+		return false;
+	}
+	OutWorldHit = FMath::Lerp(WorldStart, WorldEnd, HitTime);
+	return true;
+}
+
+bool FLandscapeGpuClusterQuadtree::IsVisible(const FVector& WorldFrom, const FVector& WorldTo) const {
+	const FVector LocalFrom = LocalToWorld.InverseTransformPosition(WorldFrom);
+	const FVector LocalTo = LocalToWorld.InverseTransformPosition(WorldTo);
+	float HitTime;
+	return !RaycastLocal(LocalFrom, LocalTo - LocalFrom, HitTime) || HitTime >= 1.f - KINDA_SMALL_NUMBER;
+}
+
+bool FLandscapeGpuClusterQuadtree::IsAreaVisible(const FVector& WorldFrom, const FBox2D& WorldArea, float HeightAboveTerrain) const {
+	const FVector2D AreaSamples[] = {
+		WorldArea.GetCenter(),
+		WorldArea.Min,
+		FVector2D(WorldArea.Max.X, WorldArea.Min.Y),
+		FVector2D(WorldArea.Min.X, WorldArea.Max.Y),
+		WorldArea.Max
+	};
+	for (const FVector2D& AreaSample : AreaSamples) {
+		float TerrainHeight;
+		if (GetHeight(AreaSample, TerrainHeight) && IsVisible(WorldFrom, FVector(AreaSample, TerrainHeight + HeightAboveTerrain))) {
+			return true;
+		}
+	}
+	return false;
+}
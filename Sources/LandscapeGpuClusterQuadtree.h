@@ -0,0 +1,45 @@
+#pragma once
+#include "CoreMinimal.h"
+
+class ALandscapeProxy;
+
+/**
+ * Min/max quadtree over the clusters of the GPU landscape, for height, raycast and visibility queries without the collision
+ * A leaf is a cluster, its height range comes from the cluster bounds, and the leaves are refined by the baked vertex heights
+ * The tree is immutable once built, so the queries are thread safe, see ALandscapeProxy::GetClusterQuadtree
+ */
+class LANDSCAPE_API FLandscapeGpuClusterQuadtree {
+public:
+	FLandscapeGpuClusterQuadtree(const ALandscapeProxy* LandscapeProxy);
+
+	inline bool IsValid() const { return Levels.Num() > 0; }
+
+	//World space queries, the landscape is expected to have no pitch and roll
+	bool GetHeight(const FVector2D& WorldPosition, float& OutHeight) const;
+	bool Raycast(const FVector& WorldStart, const FVector& WorldEnd, FVector& OutWorldHit) const;
+	bool IsVisible(const FVector& WorldFrom, const FVector& WorldTo) const;
+	bool IsAreaVisible(const FVector& WorldFrom, const FBox2D& WorldArea, float HeightAboveTerrain) const; //True if the center or a corner of the area is visible
+
+private:
+	//Level0 holds the clusters, a cell of LevelN covers 2^N x 2^N clusters
+	struct FLevel {
+		FIntPoint Size;
+		TArray<float> MinZ; //Empty cells have MinZ > MaxZ
+		TArray<float> MaxZ;
+	};
+
+	inline float GetVertexHeight(int32 VertexX, int32 VertexY) const;
+	inline int32 GetClusterFirstQuad(int32 ClusterIndex) const;
+	inline void GetCellQuads(int32 Level, int32 CellX, int32 CellY, FIntPoint& OutMin, FIntPoint& OutMax) const;
+	bool GetLocalHeight(float LocalX, float LocalY, float& OutHeight) const;
+	bool RaycastLocal(const FVector& Start, const FVector& Delta, float& OutTime) const;
+	bool RaycastCluster(int32 ClusterX, int32 ClusterY, const FVector& Start, const FVector& Delta, float TimeEnter, float TimeExit, float& OutTime) const;
+
+	TArray<FLevel> Levels;
+	TArray<uint16> Heights; //See ALandscapeProxy::LandscapeClusterHeights
+	FIntPoint NumVerts;
+	FIntPoint NumClusters;
+	int32 ClusterSizePerSection;
+	int32 SectionSizeQuads;
+	FTransform LocalToWorld;
+};
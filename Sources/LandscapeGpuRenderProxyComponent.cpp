@@ -1,8 +1,22 @@
 #include "LandscapeGpuRenderProxyComponent.h"
 #include "LandscapeComponent.h"
 #include "LandscapeProxy.h"
+#include "LandscapeGpuVirtualHeightmap.h"
 #include "LandscapeMobileGPURender.h"
 #include "LandscapeDataAccess.h"
+#include "ContentStreaming.h"
+#include "LandscapeGrassType.h"
+#include "Engine/StaticMesh.h"
+
+static void CopyMobileMaterials(const ULandscapeComponent* LandscapeComponent, TArray<TWeakObjectPtr<UMaterialInterface>>& OutMaterialInterfaces, TArray<int8>& OutLODIndexToMaterialIndex) {
+	check(LandscapeComponent->MobileMaterialInterfaces.Num() > 0);
+	OutMaterialInterfaces.Reset(LandscapeComponent->MobileMaterialInterfaces.Num());
+	for (int32 Index = 0; Index < LandscapeComponent->MobileMaterialInterfaces.Num(); ++Index) {
+		OutMaterialInterfaces.Emplace(TWeakObjectPtr<UMaterialInterface>(LandscapeComponent->MobileMaterialInterfaces[Index]));
+		check(OutMaterialInterfaces[Index].IsValid());
+	}
+	OutLODIndexToMaterialIndex = LandscapeComponent->LODIndexToMaterialIndex;
+}
 
 ULandscapeGpuRenderProxyComponent::ULandscapeGpuRenderProxyComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -11,7 +25,9 @@ ULandscapeGpuRenderProxyComponent::ULandscapeGpuRenderProxyComponent(const FObje
 	, ComponentSectionSize(0)
 	, SectionSizeQuads(0)
 	, HeightmapTexture(nullptr)
+	, VirtualHeightmap(nullptr)
 	, ProxyLocalBox(ForceInit)
+	, StreamingFinestLod(LandscapeGpuRenderParameter::FirstLod)
 //#if WITH_EDITORONLY_DATA
 //	, CachedEditingLayerData(nullptr)
 //	, LayerUpdateFlagPerMode(0)
@@ -79,6 +95,39 @@ FPrimitiveSceneProxy* ULandscapeGpuRenderProxyComponent::CreateSceneProxy() {
 	}
 }
 
+void ULandscapeGpuRenderProxyComponent::GetStreamingRenderAssetInfo(FStreamingTextureLevelContext& LevelContext, TArray<FStreamingRenderAssetPrimitiveInfo>& OutStreamingRenderAssets) const {
+	//The vertex shader samples heightmap mip = cluster Lod, so the resolution follows the finest Lod drawn instead of the distance
+	//The virtual heightmap streams its own pages by the GPU requests
+	if (VirtualHeightmap) {
+		return;
+	}
+	for (UTexture2D* StreamingTexture : HeightmapTextures) {
+		const int32 HeightmapSize = FMath::Max(StreamingTexture->GetSizeX(), StreamingTexture->GetSizeY());
+		FStreamingRenderAssetPrimitiveInfo& StreamingHeightmap = *new(OutStreamingRenderAssets)FStreamingRenderAssetPrimitiveInfo;
+		StreamingHeightmap.Bounds = Bounds.GetSphere();
+		StreamingHeightmap.TexelFactor = -(float)FMath::Max(HeightmapSize >> StreamingFinestLod, 1); // Minus Value indicate forced resolution
+		StreamingHeightmap.RenderAsset = StreamingTexture;
+	}
+}
+
+void ULandscapeGpuRenderProxyComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) {
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	//The cluster data lives on the render thread, the scene proxy keeps its last sizes
+	if (const FLandscapeGpuRenderProxyComponentSceneProxy* GpuRenderSceneProxy = static_cast<const FLandscapeGpuRenderProxyComponentSceneProxy*>(SceneProxy)) {
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(GpuRenderSceneProxy->GetReportedCPUMemory());
+		CumulativeResourceSize.AddDedicatedVideoMemoryBytes(GpuRenderSceneProxy->GetReportedGPUMemory());
+	}
+}
+
+void ULandscapeGpuRenderProxyComponent::SetStreamingFinestLod(uint32 InStreamingFinestLod) {
+	check(IsInGameThread());
+	if (StreamingFinestLod != InStreamingFinestLod) {
+		StreamingFinestLod = InStreamingFinestLod;
+		IStreamingManager::Get().NotifyPrimitiveUpdated(this);
+	}
+}
+
 void ULandscapeGpuRenderProxyComponent::Init(ULandscapeComponent* LandscapeComponent) {
 	NumComponents = 1; //Initial always 1
 
@@ -96,19 +145,22 @@ void ULandscapeGpuRenderProxyComponent::Init(ULandscapeComponent* LandscapeCompo
 	check(LandscapeComponent->CachedLocalBox.Min.X == 0 && LandscapeComponent->CachedLocalBox.Min.Y == 0);
 	
 	//Save MaterialInsterface
-	check(LandscapeComponent->MobileMaterialInterfaces.Num() > 0);
-	MobileMaterialInterfaces.Reserve(LandscapeComponent->MobileMaterialInterfaces.Num());
-	for (int32 Index = 0; Index < LandscapeComponent->MobileMaterialInterfaces.Num(); ++Index) {
-		MobileMaterialInterfaces.Emplace(TWeakObjectPtr<UMaterialInterface>(LandscapeComponent->MobileMaterialInterfaces[Index]));
-		check(MobileMaterialInterfaces[Index].IsValid());
-	}
+	CopyMobileMaterials(LandscapeComponent, MobileMaterialInterfaces, LODIndexToMaterialIndex);
 
 	//Save HeightMap
 	HeightmapTexture = LandscapeComponent->HeightmapTexture;
+	AddComponentHeightmap(LandscapeComponent);
+	if (CVarMobileLandscapeVirtualHeightmap.GetValueOnGameThread() != 0) {
+		VirtualHeightmap = LandscapeComponent->GetLandscapeProxy()->GetGpuVirtualHeightmap();
+		check(VirtualHeightmap == nullptr || VirtualHeightmap->SectionVerts == SectionSizeQuads + 1);
+	}
 
 	//Set transform
 	SetRelativeLocation(FVector::ZeroVector);
 	SetupAttachment(LandscapeComponent->GetLandscapeProxy()->GetRootComponent(), NAME_None);
+
+	//Save Grass
+	UpdateGpuGrass();
 }
 
 
@@ -116,6 +168,15 @@ ALandscapeProxy* ULandscapeGpuRenderProxyComponent::GetLandscapeProxy() const{
 	return CastChecked<ALandscapeProxy>(GetOuter());
 }
 
+//The landscape components have no scene proxy on the GPU path, so the pages are drawn by this component
+TArray<URuntimeVirtualTexture*> const& ULandscapeGpuRenderProxyComponent::GetRuntimeVirtualTextures() const{
+	return GetLandscapeProxy()->RuntimeVirtualTextures;
+}
+
+ERuntimeVirtualTextureMainPassType ULandscapeGpuRenderProxyComponent::GetVirtualTextureRenderPassType() const{
+	return GetLandscapeProxy()->VirtualTextureRenderPassType;
+}
+
 void ULandscapeGpuRenderProxyComponent::GetUsedMaterials(TArray<UMaterialInterface*>& OutMaterials, bool bGetDebugMaterials) const{
 	// TODO - investigate whether this is correct
 
@@ -139,10 +200,18 @@ void ULandscapeGpuRenderProxyComponent::GetUsedMaterials(TArray<UMaterialInterfa
 	//{
 	//	OutMaterials.Add(OverrideHoleMaterial);
 	//}
-	OutMaterials.Reserve(MobileMaterialInterfaces.Num());
+	OutMaterials.Reserve(MobileMaterialInterfaces.Num() + HoleMaterialInterfaces.Num());
 	for (int32 Index = 0; Index < MobileMaterialInterfaces.Num(); ++Index) {
 		OutMaterials.Emplace(MobileMaterialInterfaces[Index].Get());
 	}
+	for (int32 Index = 0; Index < HoleMaterialInterfaces.Num(); ++Index) {
+		OutMaterials.Emplace(HoleMaterialInterfaces[Index].Get());
+	}
+	for (UStaticMesh* GrassMesh : GrassMeshes) {
+		for (int32 Index = 0; Index < GrassMesh->StaticMaterials.Num(); ++Index) {
+			OutMaterials.Emplace(GrassMesh->GetMaterial(Index));
+		}
+	}
 
 //#if WITH_EDITORONLY_DATA
 //	if (EditToolRenderData.ToolMaterial)
@@ -179,16 +248,116 @@ void ULandscapeGpuRenderProxyComponent::UpdateBoundingInformation(const FBox& Co
 
 void ULandscapeGpuRenderProxyComponent::CheckResources(ULandscapeComponent* LandscapeComponent) {
 	check(HeightmapTexture != nullptr);
-	check(HeightmapTexture == LandscapeComponent->HeightmapTexture);
+	check(LandscapeComponent->HeightmapTexture != nullptr);
+	AddComponentHeightmap(LandscapeComponent);
+}
+
+void ULandscapeGpuRenderProxyComponent::AddComponentHeightmap(ULandscapeComponent* LandscapeComponent) {
+	//The components may be registered again, the key keeps one entry per component
+	UTexture2D* ComponentHeightmap = LandscapeComponent->HeightmapTexture;
+	FLandscapeGpuRenderComponentHeightmap& ComponentHeightmapRef = ComponentHeightmaps.FindOrAdd(LandscapeComponent->GetSectionBase() / LandscapeComponent->ComponentSizeQuads);
+	ComponentHeightmapRef.HeightmapIndex = HeightmapTextures.AddUnique(ComponentHeightmap);
+	ComponentHeightmapRef.HeightmapTexel = FIntPoint(
+		FMath::RoundToInt(LandscapeComponent->HeightmapScaleBias.Z * ComponentHeightmap->GetSizeX()),
+		FMath::RoundToInt(LandscapeComponent->HeightmapScaleBias.W * ComponentHeightmap->GetSizeY())
+	);
+	check(VirtualHeightmap != nullptr || static_cast<uint32>(HeightmapTextures.Num()) <= LandscapeGpuRenderParameter::HeightmapArrayMaxSlices);
+}
+
+void ULandscapeGpuRenderProxyComponent::UpdateHoleMaterials() {
+	//The components with holes use the masked material, it just goes to the partially hole clusters
+	//A component is known to have holes by its cluster hole flags, the visibility layer is editor only
+	ALandscapeProxy* LandscapeProxy = GetLandscapeProxy();
+	const TArray<uint8>& ClusterHoleFlags = LandscapeProxy->GetClusterHoleFlags(ProxyLocalBox);
+	HoleMaterialInterfaces.Empty();
+	HoleLODIndexToMaterialIndex.Empty();
+	if (ClusterHoleFlags.Num() == 0) {
+		return;
+	}
+
+	const uint32 ClusterSizePerComponent = (SectionSizeQuads + 1) / LandscapeGpuRenderParameter::ClusterQuadSize * ComponentSectionSize;
+	const uint32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
+	const uint32 LandscapeComponentSizeX = static_cast<uint32>(ProxyLocalBox.GetSize().X) / (SectionSizeQuads * ComponentSectionSize);
+	bool bSolidMaterialsFound = false;
+	for (ULandscapeComponent* LandscapeComponent : LandscapeProxy->LandscapeComponents) {
+		const FIntPoint ComponentBase = LandscapeComponent->GetSectionBase() / LandscapeComponent->ComponentSizeQuads;
+		const uint32 StartIndex = (ComponentBase.Y * LandscapeComponentSizeX + ComponentBase.X) * ClusterSqureSizePerComponent;
+		bool bComponentHasHoles = false;
+		for (uint32 LinearIndex = 0; LinearIndex < ClusterSqureSizePerComponent && !bComponentHasHoles; ++LinearIndex) {
+			bComponentHasHoles = ClusterHoleFlags[StartIndex + LinearIndex] != 0;
+		}
+
+		if (bComponentHasHoles && HoleMaterialInterfaces.Num() == 0) {
+			CopyMobileMaterials(LandscapeComponent, HoleMaterialInterfaces, HoleLODIndexToMaterialIndex);
+		}
+		else if (!bComponentHasHoles && !bSolidMaterialsFound) {
+			CopyMobileMaterials(LandscapeComponent, MobileMaterialInterfaces, LODIndexToMaterialIndex); //Init may have taken the masked one
+			bSolidMaterialsFound = true;
+		}
+	}
+}
+
+void ULandscapeGpuRenderProxyComponent::UpdateGpuGrass() {
+	GrassVarieties.Empty();
+	GrassMeshes.Empty();
+	GrassCullDistances.Empty();
+	GrassMinLods.Empty();
+	GrassWeightmaps.Empty();
+	ALandscapeProxy* LandscapeProxy = GetLandscapeProxy();
+	if (CVarMobileLandscapeGpuGrass.GetValueOnGameThread() == 0 || LandscapeProxy->WholeWeightmaps.Num() == 0) {
+		return;
+	}
+
+	//The shader reads two weightmaps, and a sample spawns at most one instance per variety
+	constexpr int32 MaxGrassWeightmaps = 2;
+	const FVector LandscapeScale = LandscapeProxy->GetRootComponent()->GetComponentScale();
+	const float SampleSpacing = static_cast<float>(LandscapeGpuRenderParameter::ClusterQuadSize) / LandscapeGpuRenderParameter::GrassSamplesPerClusterSide;
+	const float SampleArea = SampleSpacing * SampleSpacing * FMath::Abs(LandscapeScale.X * LandscapeScale.Y);
+	for (const FLandscapeGpuGrassLayer& GrassLayer : LandscapeProxy->GpuGrassLayers) {
+		const int32 LayerIndex = LandscapeProxy->WholeWeightmapLayerNames.IndexOfByKey(GrassLayer.LayerName);
+		if (GrassLayer.GrassType == nullptr || LayerIndex == INDEX_NONE || LayerIndex / 4 >= FMath::Min(LandscapeProxy->WholeWeightmaps.Num(), MaxGrassWeightmaps)) {
+			continue;
+		}
+		for (const FGrassVariety& GrassVariety : GrassLayer.GrassType->GrassVarieties) {
+			if (GrassVariety.GrassMesh == nullptr || GrassVariety.GrassMesh->RenderData == nullptr) {
+				continue;
+			}
+			if (static_cast<uint32>(GrassVarieties.Num()) == LandscapeGpuRenderParameter::GrassMaxVarieties) {
+				UE_LOG(LogLandscape, Warning, TEXT("%s: GPU grass supports %u varieties, the others are skipped"), *LandscapeProxy->GetName(), LandscapeGpuRenderParameter::GrassMaxVarieties);
+				break;
+			}
+
+			//GrassDensity is per 10 square meters
+			FLandscapeGpuGrassVariety& Variety = GrassVarieties.AddDefaulted_GetRef();
+			Variety.WeightmapIndex = LayerIndex / 4;
+			Variety.WeightmapChannel = LayerIndex % 4;
+			Variety.SampleDensity = FMath::Min(GrassVariety.GrassDensity.GetValue() * SampleArea / 100000.f, 1.f);
+			Variety.Scale = GrassVariety.ScaleX; //Uniform scaling
+			Variety.bRandomRotation = GrassVariety.RandomRotation;
+			GrassMeshes.Emplace(GrassVariety.GrassMesh);
+			GrassCullDistances.Emplace(GrassVariety.StartCullDistance.GetValue(), GrassVariety.EndCullDistance.GetValue());
+			GrassMinLods.Emplace(GrassVariety.MinLOD);
+		}
+	}
+	if (GrassVarieties.Num() > 0) {
+		GrassWeightmaps.Append(LandscapeProxy->WholeWeightmaps.GetData(), FMath::Min(LandscapeProxy->WholeWeightmaps.Num(), MaxGrassWeightmaps));
+	}
 }
 
 void ULandscapeGpuRenderProxyComponent::CreateClusterBoundingBox(const FLandscapeSubmitData& LandscapeSubmitData) {
-	const TArray<FBox>& SubmitToRenderThreadBoundingBox = GetLandscapeProxy()->GetClusterBoundingBox(ProxyLocalBox);
+	TArray<uint8> SubmitToRenderThreadHoleFlags = GetLandscapeProxy()->LandscapeClusterHoleFlags; //Built by UpdateHoleMaterials
 	FMatrix LocalToWorldMatrix = GetRenderMatrix();
-	ENQUEUE_RENDER_COMMAND(RegisterGPURenderLandscapeEntity)(
-		[&SubmitToRenderThreadBoundingBox, LandscapeSubmitData, LocalToWorldMatrix](FRHICommandList& RHICmdList) {
-			auto& RenderComponent = FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderComponent_RenderThread(LandscapeSubmitData.UniqueWorldId, LandscapeSubmitData.LandscapeKey);
-			RenderComponent.InitClusterData(SubmitToRenderThreadBoundingBox, LocalToWorldMatrix);
+	//The bounds are submitted from the worker thread that built them, the component may be gone by then
+	GetLandscapeProxy()->BuildClusterBoundingBoxAsync(ProxyLocalBox,
+		[SubmitToRenderThreadHoleFlags = MoveTemp(SubmitToRenderThreadHoleFlags), LandscapeSubmitData, LocalToWorldMatrix](const TArray<uint32>& ClusterHeightRanges) mutable {
+			ENQUEUE_RENDER_COMMAND(InitGPURenderLandscapeClusterData)(
+				[SubmitToRenderThreadHeightRanges = ClusterHeightRanges, SubmitToRenderThreadHoleFlags = MoveTemp(SubmitToRenderThreadHoleFlags), LandscapeSubmitData, LocalToWorldMatrix](FRHICommandList& RHICmdList) mutable {
+					TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe> RenderComponent = FMobileLandscapeGPURenderSystem_RenderThread::FindLandscapeGPURenderComponentHandle_RenderThread(LandscapeSubmitData.UniqueWorldId, LandscapeSubmitData.LandscapeKey);
+					if (RenderComponent.IsValid()) {
+						RenderComponent->InitClusterData(MoveTemp(SubmitToRenderThreadHeightRanges), MoveTemp(SubmitToRenderThreadHoleFlags), LocalToWorldMatrix);
+					}
+				}
+			);
 		}
 	);
 	bIsClusterBoundingCreated = true;
@@ -8,6 +8,14 @@
 
 class ULandscapeComponent;
 class ALandscapeProxy;
+class ULandscapeGpuVirtualHeightmap;
+class UStaticMesh;
+
+//Where a landscape component sits in the heightmaps of the proxy
+struct FLandscapeGpuRenderComponentHeightmap {
+	uint32 HeightmapIndex; //Index of HeightmapTextures
+	FIntPoint HeightmapTexel; //Texel of the first vertex of the component, from HeightmapScaleBias
+};
 
 UCLASS()
 class ULandscapeGpuRenderProxyComponent : public UPrimitiveComponent
@@ -18,14 +26,22 @@ class ULandscapeGpuRenderProxyComponent : public UPrimitiveComponent
 
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
 	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual void GetStreamingRenderAssetInfo(FStreamingTextureLevelContext& LevelContext, TArray<FStreamingRenderAssetPrimitiveInfo>& OutStreamingRenderAssets) const override;
+	virtual TArray<URuntimeVirtualTexture*> const& GetRuntimeVirtualTextures() const override;
+	virtual ERuntimeVirtualTextureMainPassType GetVirtualTextureRenderPassType() const override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 
 	ALandscapeProxy* GetLandscapeProxy() const;
 	void GetUsedMaterials(TArray<UMaterialInterface*>& OutMaterials, bool bGetDebugMaterials) const;
 	void Init(ULandscapeComponent* LandscapeComponent);
 	void UpdateBoundingInformation(const FBox& ComponentCachedLocalBox, const FIntPoint& ComponentQuadBase);
 	void CheckResources(ULandscapeComponent* LandscapeComponent);
+	void AddComponentHeightmap(ULandscapeComponent* LandscapeComponent);
+	void UpdateHoleMaterials();
+	void UpdateGpuGrass();
 	void CreateClusterBoundingBox(const FLandscapeSubmitData& LandscapeSubmitData);
 	inline bool IsClusterBoundingCreated() const { return bIsClusterBoundingCreated; }
+	void SetStreamingFinestLod(uint32 InStreamingFinestLod);
 
 public:
 	//[Don't Serialize]
@@ -43,6 +59,15 @@ public:
 	//[Don't Serialize]
 	UTexture2D* HeightmapTexture; // PC : Heightmap, Mobile : Weightmap
 
+	//[Don't Serialize]
+	TArray<UTexture2D*> HeightmapTextures; //All heightmaps of the components, more than one are drawn through a texture array
+
+	//[Don't Serialize]
+	TMap<FIntPoint, FLandscapeGpuRenderComponentHeightmap> ComponentHeightmaps; //Key is the component base in components
+
+	//[Don't Serialize]
+	ULandscapeGpuVirtualHeightmap* VirtualHeightmap; //Owned by the LandscapeProxy, replaces HeightmapTexture when valid
+
 	//[Don't Serialize]
 	FBox ProxyLocalBox;
 
@@ -51,4 +76,31 @@ public:
 
 	//[Don't Serialize]
 	TArray<TWeakObjectPtr<UMaterialInterface>> MobileMaterialInterfaces;
+
+	//[Don't Serialize]
+	TArray<int8> LODIndexToMaterialIndex; //Index of MobileMaterialInterfaces
+
+	//[Don't Serialize]
+	TArray<TWeakObjectPtr<UMaterialInterface>> HoleMaterialInterfaces; //Of a component with holes, for the partially hole clusters
+
+	//[Don't Serialize]
+	TArray<int8> HoleLODIndexToMaterialIndex; //Index of HoleMaterialInterfaces
+
+	//[Don't Serialize]
+	uint32 StreamingFinestLod; //Finest cluster Lod drawn by the GPU, the heightmap keeps the mips from this Lod
+
+	//[Don't Serialize]
+	TArray<FLandscapeGpuGrassVariety> GrassVarieties; //See ALandscapeProxy::GpuGrassLayers, empty without CVarMobileLandscapeGpuGrass
+
+	//[Don't Serialize]
+	TArray<UStaticMesh*> GrassMeshes; //Per grass variety
+
+	//[Don't Serialize]
+	TArray<FInt32Interval> GrassCullDistances; //Per grass variety
+
+	//[Don't Serialize]
+	TArray<int32> GrassMinLods; //Per grass variety
+
+	//[Don't Serialize]
+	TArray<UTexture2D*> GrassWeightmaps; //Whole weightmaps of the LandscapeProxy
 };
\ No newline at end of file
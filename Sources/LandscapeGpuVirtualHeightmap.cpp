@@ -0,0 +1,82 @@
+#include "LandscapeGpuVirtualHeightmap.h"
+#include "LandscapeProxy.h"
+#include "LandscapeComponent.h"
+#include "LandscapeMobileGPURenderEngine.h"
+#include "Engine/Texture2D.h"
+
+ULandscapeGpuVirtualHeightmap::ULandscapeGpuVirtualHeightmap(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, SectionVerts(0)
+	, NumSectionPages(0, 0)
+{
+	PageBulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+}
+
+void ULandscapeGpuVirtualHeightmap::Serialize(FArchive& Ar) {
+	Super::Serialize(Ar);
+	PageBulkData.Serialize(Ar, this);
+}
+
+#if WITH_EDITOR
+void ULandscapeGpuVirtualHeightmap::BuildPages(const ALandscapeProxy* LandscapeProxy) {
+	check(LandscapeProxy->LandscapeComponents.Num() > 0);
+	const int32 NumSubsections = LandscapeProxy->NumSubsections;
+	const int32 ComponentSizeQuads = LandscapeProxy->ComponentSizeQuads;
+	SectionVerts = LandscapeProxy->SubsectionSizeQuads + 1;
+
+	//Same as the render thread, the landscape starts from component 0
+	FIntPoint ComponentMax(0, 0);
+	for (const ULandscapeComponent* LandscapeComponent : LandscapeProxy->LandscapeComponents) {
+		const FIntPoint ComponentBase = LandscapeComponent->GetSectionBase() / ComponentSizeQuads;
+		check(ComponentBase.X >= 0 && ComponentBase.Y >= 0);
+		ComponentMax = ComponentMax.ComponentMax(ComponentBase);
+	}
+	NumSectionPages = (ComponentMax + FIntPoint(1, 1)) * NumSubsections;
+
+	const int64 PageDataSize = LandscapeGpuRenderParameter::GetVirtualHeightmapPageDataSize(SectionVerts);
+	const int64 NumPages = LandscapeGpuRenderParameter::GetVirtualHeightmapLevelFirstPage(NumSectionPages, LandscapeGpuRenderParameter::VirtualHeightmapLevelCount);
+	PageBulkData.ResetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+	PageBulkData.Lock(LOCK_READ_WRITE);
+	uint8* PageData = static_cast<uint8*>(PageBulkData.Realloc(NumPages * PageDataSize));
+	FMemory::Memzero(PageData, NumPages * PageDataSize);
+
+	//The components may use different heightmaps, every section is copied from the heightmap of its component
+	for (const ULandscapeComponent* LandscapeComponent : LandscapeProxy->LandscapeComponents) {
+		UTexture2D* HeightmapTexture = LandscapeComponent->GetHeightmap();
+		const FIntPoint ComponentBase = LandscapeComponent->GetSectionBase() / ComponentSizeQuads;
+		const int32 HeightmapSizeX = HeightmapTexture->Source.GetSizeX();
+		const int32 HeightmapSizeY = HeightmapTexture->Source.GetSizeY();
+		const FIntPoint HeightmapOffset(FMath::RoundToInt(LandscapeComponent->HeightmapScaleBias.Z * HeightmapSizeX), FMath::RoundToInt(LandscapeComponent->HeightmapScaleBias.W * HeightmapSizeY));
+		check(HeightmapTexture->Source.GetNumMips() >= static_cast<int32>(LandscapeGpuRenderParameter::VirtualHeightmapLevelCount));
+
+		for (uint32 Level = 0; Level < LandscapeGpuRenderParameter::VirtualHeightmapLevelCount; ++Level) {
+			const int32 LevelSectionVerts = SectionVerts >> Level;
+			const int32 MipSizeX = FMath::Max(HeightmapSizeX >> Level, 1);
+			const FIntPoint LevelPages = LandscapeGpuRenderParameter::GetVirtualHeightmapLevelPages(NumSectionPages, Level);
+			const int64 LevelFirstPage = LandscapeGpuRenderParameter::GetVirtualHeightmapLevelFirstPage(NumSectionPages, Level);
+			const FColor* MipData = reinterpret_cast<const FColor*>(HeightmapTexture->Source.LockMip(Level));
+
+			for (int32 SubsectionY = 0; SubsectionY < NumSubsections; ++SubsectionY) {
+				for (int32 SubsectionX = 0; SubsectionX < NumSubsections; ++SubsectionX) {
+					const FIntPoint SectionBlock = ComponentBase * NumSubsections + FIntPoint(SubsectionX, SubsectionY);
+					const FIntPoint Page(SectionBlock.X >> Level, SectionBlock.Y >> Level);
+					const FIntPoint SectionInPage = SectionBlock - FIntPoint(Page.X << Level, Page.Y << Level);
+					FColor* PageTexels = reinterpret_cast<FColor*>(PageData + (LevelFirstPage + Page.Y * LevelPages.X + Page.X) * PageDataSize);
+
+					const FIntPoint SourceTexel = (HeightmapOffset + FIntPoint(SubsectionX, SubsectionY) * SectionVerts) / (1 << Level);
+					const FIntPoint DestTexel = SectionInPage * LevelSectionVerts;
+					for (int32 TexelY = 0; TexelY < LevelSectionVerts; ++TexelY) {
+						FMemory::Memcpy(
+							&PageTexels[(DestTexel.Y + TexelY) * SectionVerts + DestTexel.X],
+							&MipData[(SourceTexel.Y + TexelY) * MipSizeX + SourceTexel.X],
+							LevelSectionVerts * sizeof(FColor)
+						);
+					}
+				}
+			}
+			HeightmapTexture->Source.UnlockMip(Level);
+		}
+	}
+	PageBulkData.Unlock();
+}
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "UObject/Object.h"
+#include "Serialization/BulkData.h"
+
+#include "LandscapeGpuVirtualHeightmap.generated.h"
+
+class ALandscapeProxy;
+
+/**
+ * Heightmap pages of the GPU landscape, streamed by FLandscapeVirtualHeightmap_RenderThread
+ * A LevelN page holds the heightmap mipN of 2^N x 2^N sections, see LandscapeGpuRenderParameter::GetVirtualHeightmapLevelFirstPage
+ */
+UCLASS()
+class ULandscapeGpuVirtualHeightmap : public UObject
+{
+	GENERATED_UCLASS_BODY()
+
+	virtual void Serialize(FArchive& Ar) override;
+
+#if WITH_EDITOR
+	void BuildPages(const ALandscapeProxy* LandscapeProxy);
+#endif
+
+public:
+	UPROPERTY()
+	int32 SectionVerts;
+
+	UPROPERTY()
+	FIntPoint NumSectionPages; //Level0 pages, one per section
+
+	//[Custom Serialize]
+	FByteBulkData PageBulkData; //Not inline, the pages are read on demand
+};
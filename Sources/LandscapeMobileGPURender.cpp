@@ -4,10 +4,18 @@
 #include "SceneView.h"
 #include "MobileGpuDriven.h"
 #include "LandscapeGpuRenderProxyComponent.h"
+#include "LandscapeGpuVirtualHeightmap.h"
+#include "Async/Async.h"
+#include "RenderUtils.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
 
 IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeGpuRenderUniformBuffer, "LandscapeGpuRenderUniformBuffer");
 
-TMap<uint32, FMobileLandscapeGPURenderSystem_GameThread*> FMobileLandscapeGPURenderSystem_GameThread::LandscapeGPURenderSystem_GameThread;
+DECLARE_MEMORY_STAT(TEXT("GPU Render Cluster CPU Mem"), STAT_LandscapeGpuRenderCPUMem, STATGROUP_Landscape);
+DECLARE_MEMORY_STAT(TEXT("GPU Render Cluster GPU Mem"), STAT_LandscapeGpuRenderGPUMem, STATGROUP_Landscape);
+
+TMap<uint32, TUniquePtr<FMobileLandscapeGPURenderSystem_GameThread>> FMobileLandscapeGPURenderSystem_GameThread::LandscapeGPURenderSystem_GameThread;
 
 FMobileLandscapeGPURenderSystem_GameThread::FMobileLandscapeGPURenderSystem_GameThread(/*uint32 NumComponents*/)
 	//: NumComponents(0)
@@ -21,55 +29,86 @@ FMobileLandscapeGPURenderSystem_GameThread::~FMobileLandscapeGPURenderSystem_Gam
 }
 
 void FMobileLandscapeGPURenderSystem_GameThread::RegisterGPURenderLandscapeEntity(ULandscapeComponent* LandscapeComponent) {
-	const bool bMobileFeatureLevel = GEngine->GetDefaultWorldFeatureLevel() == ERHIFeatureLevel::ES3_1 || LandscapeComponent->GetWorld()->FeatureLevel == ERHIFeatureLevel::ES3_1;
+	//The proxy registers the components of its deferred window at once in PostRegisterAllComponents
+	if (LandscapeComponent->GetLandscapeProxy()->DeferGpuRenderRegistration(LandscapeComponent)) {
+		return;
+	}
+	RegisterGPURenderLandscapeEntities(MakeArrayView(&LandscapeComponent, 1));
+}
+
+void FMobileLandscapeGPURenderSystem_GameThread::RegisterGPURenderLandscapeProxy(ALandscapeProxy* LandscapeProxy) {
+	//Just the components registered in the deferred window, an already registered proxy runs Pre and PostRegisterAllComponents again (UpdateWorldComponents, undo)
+	const TArray<ULandscapeComponent*> DeferredComponents = LandscapeProxy->TakeDeferredGpuRenderComponents();
+	RegisterGPURenderLandscapeEntities(DeferredComponents);
+}
+
+void FMobileLandscapeGPURenderSystem_GameThread::RegisterGPURenderLandscapeEntities(TArrayView<ULandscapeComponent* const> LandscapeComponents) {
+	if (LandscapeComponents.Num() == 0) {
+		return;
+	}
+
+	ULandscapeComponent* FirstComponent = LandscapeComponents[0];
+	const bool bMobileFeatureLevel = GEngine->GetDefaultWorldFeatureLevel() == ERHIFeatureLevel::ES3_1 || FirstComponent->GetWorld()->FeatureLevel == ERHIFeatureLevel::ES3_1;
 	if (CVarMobileLandscapeGpuRender.GetValueOnGameThread() != 0 && bMobileFeatureLevel) {
 		check(IsInGameThread());
-		check(LandscapeComponent->GetWorld());
-		check(LandscapeComponent->GetLandscapeProxy());
-		check((LandscapeComponent->SubsectionSizeQuads + 1) >= LandscapeGpuRenderParameter::ClusterQuadSize);		
-		const FLandscapeSubmitData& SubmitToRenderThreadComponentData = FLandscapeSubmitData::CreateLandscapeSubmitData(LandscapeComponent);
+		check(FirstComponent->GetWorld());
+		check(FirstComponent->GetLandscapeProxy());
+		ALandscapeProxy* LandscapeProxy = FirstComponent->GetLandscapeProxy();
+		TArray<FLandscapeSubmitData> SubmitToRenderThreadComponentData;
+		SubmitToRenderThreadComponentData.Reserve(LandscapeComponents.Num());
+		for (ULandscapeComponent* LandscapeComponent : LandscapeComponents) {
+			check(LandscapeComponent->GetLandscapeProxy() == LandscapeProxy);
+			check((LandscapeComponent->SubsectionSizeQuads + 1) >= LandscapeGpuRenderParameter::ClusterQuadSize);
+			SubmitToRenderThreadComponentData.Emplace(FLandscapeSubmitData::CreateLandscapeSubmitData(LandscapeComponent));
+		}
+
+		const FLandscapeSubmitData FirstSubmitData = SubmitToRenderThreadComponentData[0];
 
-		//At first, Submit to renderthread
+		//At first, Submit to renderthread, one command and one rebuild for the whole batch
 		//Put the code in front because FLandscapeGpuRenderProxyComponentSceneProxy will use data
 		ENQUEUE_RENDER_COMMAND(RegisterGPURenderLandscapeEntity)(
-			[SubmitToRenderThreadComponentData](FRHICommandList& RHICmdList) {
-				FMobileLandscapeGPURenderSystem_RenderThread::RegisterGPURenderLandscapeEntity_RenderThread(SubmitToRenderThreadComponentData);
+			[SubmitToRenderThreadComponentData = MoveTemp(SubmitToRenderThreadComponentData)](FRHICommandList& RHICmdList) {
+				FMobileLandscapeGPURenderSystem_RenderThread::RegisterGPURenderLandscapeEntities_RenderThread(SubmitToRenderThreadComponentData);
 			}
 		);
 
-		uint32 UniqueWorldIndex = LandscapeComponent->GetWorld()->GetUniqueID();
-		uint32 NumComponents = LandscapeComponent->GetLandscapeProxy()->LandscapeComponents.Num();
+		const FGuid& LandscapeKey = FirstSubmitData.LandscapeKey;
+		uint32 UniqueWorldIndex = FirstSubmitData.UniqueWorldId;
+		uint32 NumComponents = LandscapeProxy->LandscapeComponents.Num();
 
 		//Create System if null
-		FMobileLandscapeGPURenderSystem_GameThread** FoundSystemPtr = LandscapeGPURenderSystem_GameThread.Find(UniqueWorldIndex);
-		FMobileLandscapeGPURenderSystem_GameThread* FoundSystem = FoundSystemPtr == nullptr ? LandscapeGPURenderSystem_GameThread.Emplace(UniqueWorldIndex, new FMobileLandscapeGPURenderSystem_GameThread()) : *FoundSystemPtr;
-		FoundSystem->NumAllRegisterComponents_GameThread += 1;
-
-		//Create LandscapeProxyComponent if needed
-		ULandscapeGpuRenderProxyComponent** ComponentPtr = FoundSystem->LandscapeGpuRenderPeoxyComponens_GameThread.Find(SubmitToRenderThreadComponentData.LandscapeKey);
-		if (ComponentPtr == nullptr) {
-			ULandscapeGpuRenderProxyComponent* NewComponent = NewObject<ULandscapeGpuRenderProxyComponent>(LandscapeComponent->GetLandscapeProxy(), NAME_None);
-			NewComponent->Init(LandscapeComponent);
-			ULandscapeGpuRenderProxyComponent*& EmplaceComponent = FoundSystem->LandscapeGpuRenderPeoxyComponens_GameThread.Emplace(SubmitToRenderThreadComponentData.LandscapeKey, NewComponent);
-			ComponentPtr = &EmplaceComponent;
+		TUniquePtr<FMobileLandscapeGPURenderSystem_GameThread>& FoundSystem = LandscapeGPURenderSystem_GameThread.FindOrAdd(UniqueWorldIndex);
+		if (!FoundSystem.IsValid()) {
+			FoundSystem = MakeUnique<FMobileLandscapeGPURenderSystem_GameThread>();
 		}
-		else {
-			ULandscapeGpuRenderProxyComponent* ComponentRef = *ComponentPtr;
+		FoundSystem->NumAllRegisterComponents_GameThread += LandscapeComponents.Num();
+
+		//Create LandscapeProxyComponent if needed, Init takes the first component
+		ULandscapeGpuRenderProxyComponent*& ComponentRef = FoundSystem->LandscapeGpuRenderPeoxyComponens_GameThread.FindOrAdd(LandscapeKey);
+		int32 FirstAddedComponent = 0;
+		if (ComponentRef == nullptr) {
+			ComponentRef = NewObject<ULandscapeGpuRenderProxyComponent>(LandscapeProxy, NAME_None);
+			ComponentRef->Init(FirstComponent);
+			FirstAddedComponent = 1;
+		}
+		for (int32 ComponentIndex = FirstAddedComponent; ComponentIndex < LandscapeComponents.Num(); ++ComponentIndex) {
+			ULandscapeComponent* LandscapeComponent = LandscapeComponents[ComponentIndex];
 			ComponentRef->UpdateBoundingInformation(LandscapeComponent->CachedLocalBox, LandscapeComponent->GetSectionBase());
 			//Check resources
 			ComponentRef->CheckResources(LandscapeComponent);
 		}
 
-		ULandscapeGpuRenderProxyComponent* ComponentRef = *ComponentPtr;
 		if (ComponentRef->NumComponents == NumComponents) {
 			//Maybe by InvalidateLightingCache called, so we need to check the status of register
 			if (!ComponentRef->IsRegistered()) {
+				//The scene proxy takes the hole materials
+				ComponentRef->UpdateHoleMaterials();
 				//RegisterTo FScene, call AddPrimitive
 				ComponentRef->RegisterComponent();
 			}
 
 			if (!ComponentRef->IsClusterBoundingCreated()) {
-				ComponentRef->CreateClusterBoundingBox(SubmitToRenderThreadComponentData);
+				ComponentRef->CreateClusterBoundingBox(FirstSubmitData);
 			}
 		}
 	}
@@ -82,17 +121,14 @@ void FMobileLandscapeGPURenderSystem_GameThread::UnRegisterGPURenderLandscapeEnt
 	check(IsInGameThread());
 	check(LandscapeComponent->GetWorld());
 	check(LandscapeComponent->GetLandscapeProxy());
+	if (LandscapeComponent->GetLandscapeProxy()->CancelDeferredGpuRenderRegistration(LandscapeComponent)) {
+		return; //Not submitted yet
+	}
 	uint32 UniqueWorldIndex = LandscapeComponent->GetWorld()->GetUniqueID();
-	FMobileLandscapeGPURenderSystem_GameThread** FoundSystemPtr = LandscapeGPURenderSystem_GameThread.Find(UniqueWorldIndex);
+	TUniquePtr<FMobileLandscapeGPURenderSystem_GameThread>* FoundSystemPtr = LandscapeGPURenderSystem_GameThread.Find(UniqueWorldIndex);
 	if (FoundSystemPtr) {
-		//System Release
-		FMobileLandscapeGPURenderSystem_GameThread* FoundSystem = *FoundSystemPtr;
-		FoundSystem->NumAllRegisterComponents_GameThread -= 1;
-		if (FoundSystem->NumAllRegisterComponents_GameThread == 0) {
-			LandscapeGPURenderSystem_GameThread.Remove(UniqueWorldIndex);
-		}
-
 		//Component Release
+		FMobileLandscapeGPURenderSystem_GameThread* FoundSystem = FoundSystemPtr->Get();
 		const FGuid& LandscapeGuid = LandscapeComponent->GetLandscapeProxy()->GetLandscapeGuid();
 		ULandscapeGpuRenderProxyComponent* ComponentRef = FoundSystem->LandscapeGpuRenderPeoxyComponens_GameThread.FindChecked(LandscapeGuid);
 		ComponentRef->NumComponents -= 1;
@@ -101,6 +137,12 @@ void FMobileLandscapeGPURenderSystem_GameThread::UnRegisterGPURenderLandscapeEnt
 			FoundSystem->LandscapeGpuRenderPeoxyComponens_GameThread.Remove(LandscapeGuid);
 		}
 
+		//System Release, after the components since the map owns it
+		FoundSystem->NumAllRegisterComponents_GameThread -= 1;
+		if (FoundSystem->NumAllRegisterComponents_GameThread == 0) {
+			LandscapeGPURenderSystem_GameThread.Remove(UniqueWorldIndex);
+		}
+
 		//Submit to renderthread
 		const FLandscapeSubmitData& SubmitToRenderThreadComponentData = FLandscapeSubmitData::CreateLandscapeSubmitData(LandscapeComponent);
 		ENQUEUE_RENDER_COMMAND(UnRegisterGPURenderLandscapeEntity)(
@@ -280,73 +322,253 @@ void FLandscapeClusterVertexBuffer::InitRHI() {
 
 	for (uint32 y = 0; y < VertexSize; y++) {
 		for (uint32 x = 0; x < VertexSize; x++) {
-			Vertex->PositionX = static_cast<float>(x);
-			Vertex->PositionY = static_cast<float>(y);
-
-			//Vertex->PositionX = static_cast<uint8>(x);
-			//Vertex->PositionY = static_cast<uint8>(y);
-			//Vertex->Blank_0 = 0;
-			//Vertex->Blank_1 = 0;
+			Vertex->PositionX = static_cast<uint8>(x);
+			Vertex->PositionY = static_cast<uint8>(y);
+			Vertex->EdgeFlagsX = GetVertexEdgeFlags(x);
+			Vertex->EdgeFlagsY = GetVertexEdgeFlags(y);
 			Vertex += 1;
 		}
 	}
 	RHIUnlockVertexBuffer(VertexBufferRHI);
 }
 
-//------------------------------------------------SceneProxy------------------------------------------------//
+uint8 FLandscapeClusterVertexBuffer::GetVertexEdgeFlags(uint32 VertexCoord) {
+	uint8 EdgeFlags = 0;
+	//The vertex is on the far edge of LodN, the edge cluster is clamped to the penultimate one
+	for (uint32 LodIndex = 0; LodIndex < LandscapeGpuRenderParameter::ClusterLodCount; ++LodIndex) {
+		const uint32 LodClusterQuadSize = LandscapeGpuRenderParameter::ClusterQuadSize >> LodIndex;
+		if (VertexCoord == LodClusterQuadSize || VertexCoord + 1 == LodClusterQuadSize) {
+			EdgeFlags |= 1 << LodIndex;
+		}
+	}
+	EdgeFlags |= VertexCoord == 0 ? LandscapeGpuRenderParameter::VertexFirstEdgeFlag : 0;
+	return EdgeFlags;
+}
+
+//------------------------------------------------SharedBuffers------------------------------------------------//
+TMap<uint32, FLandscapeGpuRenderSharedBuffers*> FLandscapeGpuRenderSharedBuffers::SharedBuffersMap;
+
+FLandscapeGpuRenderSharedBuffers::FLandscapeGpuRenderSharedBuffers(uint32 InSharedBuffersKey, ERHIFeatureLevel::Type InFeatureLevel, bool bInStitchingIndexBuffer)
+	: SharedBuffersKey(InSharedBuffersKey)
+	, VertexFactory(nullptr)
+	, VertexBuffer(nullptr)
+	, IndexBuffer(nullptr)
+{
+	//Create and init VertexBuffer
+	VertexBuffer = new FLandscapeClusterVertexBuffer(); //Construct call InitResource
+
+	//Create and init IndexBuffer	
+	static_assert((LandscapeGpuRenderParameter::ClusterQuadSize + 1) * (LandscapeGpuRenderParameter::ClusterQuadSize + 1) <= 0x10000, ""); //Just support int16
+	IndexBuffer = CreateClusterIndexBuffer<uint16>(bInStitchingIndexBuffer);
+
+	//Create and init VertexFactory
+	VertexFactory = new FLandscapeGpuRenderVertexFactory(InFeatureLevel);
+	VertexFactory->MobileData.PositionComponent = FVertexStreamComponent(VertexBuffer, 0, sizeof(FLandscapeClusterVertex), VET_UByte4N); //Normalized, so the float shader input is valid on every RHI
+	VertexFactory->InitResource();
+}
+
+FLandscapeGpuRenderSharedBuffers::~FLandscapeGpuRenderSharedBuffers() {
+	delete VertexFactory;
+	VertexFactory = nullptr;
+
+	delete VertexBuffer;
+	VertexBuffer = nullptr;
+
+	IndexBuffer->ReleaseResource();
+	delete IndexBuffer;
+	IndexBuffer = nullptr;
+}
+
+FLandscapeGpuRenderSharedBuffers* FLandscapeGpuRenderSharedBuffers::Acquire(ERHIFeatureLevel::Type InFeatureLevel, bool bInStitchingIndexBuffer) {
+	check(IsInRenderingThread());
+	const uint32 Key = GetSharedBuffersKey(InFeatureLevel, bInStitchingIndexBuffer);
+	FLandscapeGpuRenderSharedBuffers* SharedBuffers = SharedBuffersMap.FindRef(Key);
+	if (SharedBuffers == nullptr) {
+		SharedBuffers = new FLandscapeGpuRenderSharedBuffers(Key, InFeatureLevel, bInStitchingIndexBuffer);
+		SharedBuffersMap.Add(Key, SharedBuffers);
+	}
+	SharedBuffers->AddRef();
+	return SharedBuffers;
+}
+
+void FLandscapeGpuRenderSharedBuffers::ReleaseShared() {
+	check(IsInRenderingThread());
+	check(this == SharedBuffersMap.FindRef(SharedBuffersKey));
+	const uint32 Key = SharedBuffersKey;
+	if (Release() == 0) {
+		SharedBuffersMap.Remove(Key);
+	}
+}
+
 template<typename IndexType>
-void FLandscapeGpuRenderProxyComponentSceneProxy::CreateClusterIndexBuffers(TArray<FIndexBuffer*>& InIndexBuffers) {
+FIndexBuffer* FLandscapeGpuRenderSharedBuffers::CreateClusterIndexBuffer(bool bInStitchingIndexBuffer) {
 	constexpr uint32 ClusterVertSize = LandscapeGpuRenderParameter::ClusterQuadSize + 1;
-	for (int32 LodLevel = 0; LodLevel < InIndexBuffers.Num(); LodLevel++) {
-		TArray<IndexType> NewIndices;
-		uint16 LodClusterQuadSize = LandscapeGpuRenderParameter::ClusterQuadSize >> LodLevel;
-		uint32 ExpectedNumIndices = LodClusterQuadSize * LodClusterQuadSize * 6;
-		NewIndices.Empty(ExpectedNumIndices);
-
-		for (uint32 y = 0; y < LodClusterQuadSize; ++y) {
-			for (uint32 x = 0; x < LodClusterQuadSize; ++x) {
-				IndexType i00 = y * ClusterVertSize + x;
-				IndexType i10 = y * ClusterVertSize + x + 1;
-				IndexType i11 = (y + 1) * ClusterVertSize + x + 1;
-				IndexType i01 = (y + 1) * ClusterVertSize + x;
-
-				NewIndices.Add(i00);
-				NewIndices.Add(i11);
-				NewIndices.Add(i10);
-
-				NewIndices.Add(i00);
-				NewIndices.Add(i01);
-				NewIndices.Add(i11);
+	const uint32 NumEdgeMask = bInStitchingIndexBuffer ? LandscapeGpuRenderParameter::ClusterEdgeMaskCount : 1;
+	const uint32 NumDrawBuckets = LandscapeGpuRenderParameter::GetSolidDrawBucketCount(bInStitchingIndexBuffer); //The hole variants share the indices
+	TArray<IndexType> NewIndices;
+	NewIndices.Empty(LandscapeGpuRenderParameter::GetLodFirstIndex(LandscapeGpuRenderParameter::ClusterLodCount) * NumEdgeMask);
+
+	for (uint32 DrawBucket = 0; DrawBucket < NumDrawBuckets; DrawBucket++) {
+		check(NewIndices.Num() == LandscapeGpuRenderParameter::GetDrawBucketFirstIndex(DrawBucket, bInStitchingIndexBuffer));
+		const uint32 LodLevel = LandscapeGpuRenderParameter::GetDrawBucketLod(DrawBucket, bInStitchingIndexBuffer);
+		const uint32 LodClusterQuadSize = LandscapeGpuRenderParameter::ClusterQuadSize >> LodLevel;
+		//The last Lod has no odd vertex to stitch
+		const uint32 EdgeMask = LodClusterQuadSize > 1 ? DrawBucket % NumEdgeMask : 0;
+
+		//The odd vertices of a stitched edge are snapped to the previous even one, so the edge matches the neighbor one Lod coarser, the vertex shader snaps further for a coarser one
+		//Degenerate triangles are kept, every variant of a Lod has the same index count
+		auto GetVertexIndex = [EdgeMask, LodClusterQuadSize, ClusterVertSize](uint32 x, uint32 y) {
+			const bool bStitchX = ((EdgeMask & 0x1) && y == LodClusterQuadSize) || ((EdgeMask & 0x4) && y == 0); //Down and Top edges run along X
+			const bool bStitchY = ((EdgeMask & 0x2) && x == 0) || ((EdgeMask & 0x8) && x == LodClusterQuadSize); //Left and Right edges run along Y
+			x = bStitchX ? (x & ~1u) : x;
+			y = bStitchY ? (y & ~1u) : y;
+			return static_cast<IndexType>(y * ClusterVertSize + x);
+		};
+
+		//Row order reloads the whole previous row once it exceeds the vertex cache, so walk the quads strip by strip
+		for (uint32 StripStartX = 0; StripStartX < LodClusterQuadSize; StripStartX += LandscapeGpuRenderParameter::ClusterIndexStripQuads) {
+			const uint32 StripEndX = FMath::Min(StripStartX + LandscapeGpuRenderParameter::ClusterIndexStripQuads, LodClusterQuadSize);
+			for (uint32 y = 0; y < LodClusterQuadSize; ++y) {
+				for (uint32 x = StripStartX; x < StripEndX; ++x) {
+					IndexType i00 = GetVertexIndex(x, y);
+					IndexType i10 = GetVertexIndex(x + 1, y);
+					IndexType i11 = GetVertexIndex(x + 1, y + 1);
+					IndexType i01 = GetVertexIndex(x, y + 1);
+
+					NewIndices.Add(i00);
+					NewIndices.Add(i11);
+					NewIndices.Add(i10);
+
+					NewIndices.Add(i00);
+					NewIndices.Add(i01);
+					NewIndices.Add(i11);
+				}
 			}
 		}
-
-		FRawStaticIndexBuffer16or32<IndexType>* RawIndexBuffer = new FRawStaticIndexBuffer16or32<IndexType>(false);
-		RawIndexBuffer->AssignNewBuffer(NewIndices);
-		RawIndexBuffer->InitResource();
-		InIndexBuffers[LodLevel] = static_cast<FIndexBuffer*>(RawIndexBuffer);
 	}
+
+	FRawStaticIndexBuffer16or32<IndexType>* RawIndexBuffer = new FRawStaticIndexBuffer16or32<IndexType>(false);
+	RawIndexBuffer->AssignNewBuffer(NewIndices);
+	RawIndexBuffer->InitResource();
+	return static_cast<FIndexBuffer*>(RawIndexBuffer);
 }
 
+//------------------------------------------------SceneProxy------------------------------------------------//
+
 const static FName NAME_GpuRenderLandscapeResourceNameForDebugging(TEXT("GpuRenderLandscape"));
 FLandscapeGpuRenderProxyComponentSceneProxy::FLandscapeGpuRenderProxyComponentSceneProxy(ULandscapeGpuRenderProxyComponent* InComponent)
 	: FPrimitiveSceneProxy(InComponent, NAME_GpuRenderLandscapeResourceNameForDebugging)
 	, UniqueWorldId(InComponent->GetWorld()->GetUniqueID())
 	, NumClusterPerSection((InComponent->SectionSizeQuads + 1) / LandscapeGpuRenderParameter::ClusterQuadSize)
 	, SectionSizeQuads(InComponent->SectionSizeQuads)
-	, VertexFactory(nullptr)
-	, VertexBuffer(nullptr)
+	, bStitchingIndexBuffer(CVarMobileLandscapeStitchingIndexBuffer.GetValueOnAnyThread() != 0)
+	, SharedBuffers(nullptr)
+	, LandscapeGpuRenderUserData()
+	, VirtualTextureUserData()
 	, LandscapeKey(InComponent->LandscapeKey)
+	, GpuRenderData(nullptr)
+	, OwnerComponent(InComponent)
 	, HeightmapTexture(InComponent->HeightmapTexture)
+	, VirtualHeightmapBulkData(nullptr)
+	, VirtualHeightmapNumSectionPages(0, 0)
+	, VirtualHeightmap(nullptr)
+	, NumSections(0, 0)
+	, HeightmapArray(nullptr)
+	, Grass(nullptr)
+	, ReportedCPUMemory(0)
+	, ReportedGPUMemory(0)
 {
 	check(GetScene().GetFeatureLevel() == ERHIFeatureLevel::ES3_1);
 	for (int32 i = 0; i < InComponent->MobileMaterialInterfaces.Num(); ++i) {
 		AvailableMaterials.Emplace(InComponent->MobileMaterialInterfaces[i].Get());
 	}
+
+	for (int32 i = 0; i < InComponent->HoleMaterialInterfaces.Num(); ++i) {
+		AvailableHoleMaterials.Emplace(InComponent->HoleMaterialInterfaces[i].Get());
+	}
+
+	//Cluster LodN has the vertex density of the landscape LodN, so use the material of that landscape Lod
+	for (uint32 LodIndex = 0; LodIndex < LandscapeGpuRenderParameter::ClusterLodCount; ++LodIndex) {
+		const int32 LandscapeLod = FMath::Min<int32>(LodIndex, InComponent->LODIndexToMaterialIndex.Num() - 1);
+		const int32 MaterialIndex = LandscapeLod >= 0 ? InComponent->LODIndexToMaterialIndex[LandscapeLod] : 0;
+		ClusterLodToMaterialIndex[LodIndex] = AvailableMaterials.IsValidIndex(MaterialIndex) && AvailableMaterials[MaterialIndex] != nullptr ? MaterialIndex : 0;
+
+		const int32 HoleLandscapeLod = FMath::Min<int32>(LodIndex, InComponent->HoleLODIndexToMaterialIndex.Num() - 1);
+		const int32 HoleMaterialIndex = HoleLandscapeLod >= 0 ? InComponent->HoleLODIndexToMaterialIndex[HoleLandscapeLod] : 0;
+		ClusterLodToHoleMaterialIndex[LodIndex] = AvailableHoleMaterials.IsValidIndex(HoleMaterialIndex) && AvailableHoleMaterials[HoleMaterialIndex] != nullptr ? HoleMaterialIndex : 0;
+	}
+
+	if (const ULandscapeGpuVirtualHeightmap* ComponentVirtualHeightmap = InComponent->VirtualHeightmap) {
+		VirtualHeightmapBulkData = &ComponentVirtualHeightmap->PageBulkData;
+		VirtualHeightmapNumSectionPages = ComponentVirtualHeightmap->NumSectionPages;
+	}
+	else if (InComponent->HeightmapTextures.Num() > 1) {
+		//Several heightmaps, every section finds its slice and texel in the section table
+		FIntPoint NumComponentsXY(0, 0);
+		for (const auto& ComponentHeightmapPair : InComponent->ComponentHeightmaps) {
+			NumComponentsXY = NumComponentsXY.ComponentMax(ComponentHeightmapPair.Key + FIntPoint(1, 1));
+		}
+		const int32 NumComponentSections = InComponent->ComponentSectionSize;
+		const int32 SectionVerts = SectionSizeQuads + 1;
+		NumSections = NumComponentsXY * NumComponentSections;
+		SectionHeightmaps.Init(0, NumSections.X * NumSections.Y);
+		SectionTexels.Init(FIntPoint::ZeroValue, NumSections.X * NumSections.Y);
+		for (const auto& ComponentHeightmapPair : InComponent->ComponentHeightmaps) {
+			for (int32 LocalSectionY = 0; LocalSectionY < NumComponentSections; ++LocalSectionY) {
+				for (int32 LocalSectionX = 0; LocalSectionX < NumComponentSections; ++LocalSectionX) {
+					const FIntPoint Section = ComponentHeightmapPair.Key * NumComponentSections + FIntPoint(LocalSectionX, LocalSectionY);
+					const int32 SectionIndex = Section.Y * NumSections.X + Section.X;
+					SectionHeightmaps[SectionIndex] = ComponentHeightmapPair.Value.HeightmapIndex;
+					SectionTexels[SectionIndex] = ComponentHeightmapPair.Value.HeightmapTexel + FIntPoint(LocalSectionX, LocalSectionY) * SectionVerts;
+				}
+			}
+		}
+
+		HeightmapArrayTextures = InComponent->HeightmapTextures;
+		for (UTexture2D* SliceTexture : HeightmapArrayTextures) {
+			HeightmapArraySizes.Emplace(SliceTexture->GetSizeX(), SliceTexture->GetSizeY());
+		}
+	}
+
+	//Every mesh section of a grass variety is an indirect draw, the instances of a variety are shared by its sections
+	for (int32 VarietyIndex = 0; VarietyIndex < InComponent->GrassVarieties.Num(); ++VarietyIndex) {
+		UStaticMesh* GrassMesh = InComponent->GrassMeshes[VarietyIndex];
+		FStaticMeshRenderData* MeshRenderData = GrassMesh->RenderData.Get();
+		const int32 MeshLod = MeshRenderData->GetCurrentFirstLODIdx(InComponent->GrassMinLods[VarietyIndex]);
+		const FStaticMeshLODResources& LODResources = MeshRenderData->LODResources[MeshLod];
+		if (GrassDraws.Num() + LODResources.Sections.Num() > static_cast<int32>(LandscapeGpuRenderParameter::GrassMaxDraws)) {
+			continue;
+		}
+
+		const uint32 Variety = GrassVarieties.Add(InComponent->GrassVarieties[VarietyIndex]);
+		for (const FStaticMeshSection& Section : LODResources.Sections) {
+			GrassDraws.Add({ Variety, Section.FirstIndex, Section.NumTriangles * 3 });
+			UMaterialInterface* SectionMaterial = GrassMesh->GetMaterial(Section.MaterialIndex);
+			GrassDrawMaterials.Emplace(SectionMaterial ? SectionMaterial : UMaterial::GetDefaultMaterial(MD_Surface));
+		}
+		GrassMeshRenderData.Emplace(MeshRenderData);
+		GrassMeshLods.Emplace(MeshLod);
+
+		FInstancingUserData& VarietyUserData = GrassUserData.AddZeroed_GetRef();
+		VarietyUserData.MeshRenderData = MeshRenderData;
+		VarietyUserData.StartCullDistance = InComponent->GrassCullDistances[VarietyIndex].Min;
+		VarietyUserData.EndCullDistance = InComponent->GrassCullDistances[VarietyIndex].Max;
+		VarietyUserData.MinLOD = MeshLod;
+		VarietyUserData.bRenderSelected = true;
+		VarietyUserData.bRenderUnselected = true;
+		VarietyUserData.AverageInstancesScale = FVector(1.f, 1.f, 1.f);
+	}
+	if (GrassVarieties.Num() > 0) {
+		GrassWeightmaps = InComponent->GrassWeightmaps;
+	}
 }
 
 FLandscapeGpuRenderProxyComponentSceneProxy::~FLandscapeGpuRenderProxyComponentSceneProxy() {
-	check(VertexFactory == nullptr);
-	check(VertexBuffer == nullptr);
+	check(SharedBuffers == nullptr);
+	check(VirtualHeightmap == nullptr);
+	check(HeightmapArray == nullptr);
+	check(Grass == nullptr);
+	check(GrassVertexFactories.Num() == 0);
 }
 
 SIZE_T FLandscapeGpuRenderProxyComponentSceneProxy::GetTypeHash() const{
@@ -355,32 +577,54 @@ SIZE_T FLandscapeGpuRenderProxyComponentSceneProxy::GetTypeHash() const{
 }
 
 void FLandscapeGpuRenderProxyComponentSceneProxy::ApplyWorldOffset(FVector InOffset) {
-	
+	FPrimitiveSceneProxy::ApplyWorldOffset(InOffset); //Goes through OnTransformChanged, the cluster data is in landscape space
 }
 
 bool FLandscapeGpuRenderProxyComponentSceneProxy::CanBeOccluded() const {
 	return false; //hardware Occlusion Culling
 }
 
+int32 FLandscapeGpuRenderProxyComponentSceneProxy::CollectOccluderElements(FOccluderElementsCollector& Collector) const {
+	//The occluder mesh is built in landscape space with the cluster bounds, see BuildOccluderMesh
+	if (!GpuRenderData.IsValid() || !GpuRenderData->OccluderIndices.IsValid()) {
+		return 0;
+	}
+
+	Collector.AddElements(GpuRenderData->OccluderVertices, GpuRenderData->OccluderIndices, GetLocalToWorld());
+	return 1;
+}
+
 void FLandscapeGpuRenderProxyComponentSceneProxy::GetLightRelevance(const FLightSceneProxy* LightSceneProxy, bool& bDynamic, bool& bRelevant, bool& bLightMapped, bool& bShadowMapped) const {
 	FPrimitiveSceneProxy::GetLightRelevance(LightSceneProxy, bDynamic, bRelevant, bLightMapped, bShadowMapped);
 }
 
 void FLandscapeGpuRenderProxyComponentSceneProxy::OnTransformChanged() {
+	UpdateLandscapeGpuRenderUniformBuffer();
+
+	//Moves and world origin rebasing just update the matrix the culling reads, before CreateRenderThreadResources there is no render component yet
+	if (GpuRenderData.IsValid()) {
+		GpuRenderData->SetLocalToWorld(GetLocalToWorld());
+	}
+}
+
+void FLandscapeGpuRenderProxyComponentSceneProxy::UpdateLandscapeGpuRenderUniformBuffer() {
 	// cache component's WorldToLocal
 	FMatrix LocalToWorldNoScaling = GetLocalToWorld();
 	LocalToWorldNoScaling.RemoveScaling();
 
 	FLandscapeGpuRenderUniformBuffer LandscapeGpuRenderParams;
 	LandscapeGpuRenderParams.NumClusterPerSection = NumClusterPerSection;
+	LandscapeGpuRenderParams.StitchingIndexBuffer = bStitchingIndexBuffer ? 1 : 0;
 	LandscapeGpuRenderParams.QuadSizeParameter = FVector2D(LandscapeGpuRenderParameter::ClusterQuadSize, SectionSizeQuads);
 
-	//Calculate the HeightmapUVParameter
+	//Calculate the HeightmapUVParameter, the virtual heightmap samples the atlas and the heightmap array its slices
+	const int32 HeightmapSizeX = VirtualHeightmap ? VirtualHeightmap->GetAtlasSize() : (HeightmapArray ? HeightmapArray->GetArraySize() : HeightmapTexture->GetSizeX());
+	const int32 HeightmapSizeY = VirtualHeightmap ? VirtualHeightmap->GetAtlasSize() : (HeightmapArray ? HeightmapArray->GetArraySize() : HeightmapTexture->GetSizeY());
 	FVector4 HeightmapUVParameter = FVector4(
-		((float)(SectionSizeQuads + 1) / (float)FMath::Max<int32>(1, HeightmapTexture->GetSizeX())),
-		((float)(SectionSizeQuads + 1) / (float)FMath::Max<int32>(1, HeightmapTexture->GetSizeY())),
-		1.0f / (float)HeightmapTexture->GetSizeX(), 
-		1.0f / (float)HeightmapTexture->GetSizeY()
+		((float)(SectionSizeQuads + 1) / (float)FMath::Max<int32>(1, HeightmapSizeX)),
+		((float)(SectionSizeQuads + 1) / (float)FMath::Max<int32>(1, HeightmapSizeY)),
+		1.0f / (float)HeightmapSizeX, 
+		1.0f / (float)HeightmapSizeY
 	);
 	LandscapeGpuRenderParams.HeightmapUVParameter = HeightmapUVParameter;
 	LandscapeGpuRenderParams.LocalToWorldNoScaling = LocalToWorldNoScaling;
@@ -390,8 +634,31 @@ void FLandscapeGpuRenderProxyComponentSceneProxy::OnTransformChanged() {
 	//WeightmapSubsectionOffset = (float)(SubsectionSizeQuads + 1) / (float)WeightmapSize;
 
 	//SetHeightmap
-	LandscapeGpuRenderParams.HeightmapTexture = HeightmapTexture->TextureReference.TextureReferenceRHI;
 	LandscapeGpuRenderParams.HeightmapTextureSampler = TStaticSamplerState<SF_Point>::GetRHI();
+	if (VirtualHeightmap) {
+		LandscapeGpuRenderParams.VirtualHeightmap = 1;
+		LandscapeGpuRenderParams.VirtualHeightmapParameter = FIntVector4(VirtualHeightmap->NumSectionPages.X, VirtualHeightmap->NumSectionPages.Y, VirtualHeightmap->SlotsPerRow, 0);
+		LandscapeGpuRenderParams.HeightmapTexture = VirtualHeightmap->PhysicalAtlas_GPU;
+		LandscapeGpuRenderParams.VirtualHeightmapPageTable = VirtualHeightmap->PageTable_GPU.SRV;
+	}
+	else {
+		LandscapeGpuRenderParams.VirtualHeightmap = 0;
+		LandscapeGpuRenderParams.VirtualHeightmapParameter = FIntVector4(0, 0, 0, 0);
+		LandscapeGpuRenderParams.HeightmapTexture = HeightmapTexture->TextureReference.TextureReferenceRHI;
+		LandscapeGpuRenderParams.VirtualHeightmapPageTable = GWhiteVertexBufferWithSRV->ShaderResourceViewRHI; //Never read
+	}
+	if (HeightmapArray) {
+		LandscapeGpuRenderParams.HeightmapArray = 1;
+		LandscapeGpuRenderParams.HeightmapArrayParameter = FIntVector4(NumSections.X, NumSections.Y, 0, 0);
+		LandscapeGpuRenderParams.HeightmapTextureArray = HeightmapArray->HeightmapArray_GPU;
+		LandscapeGpuRenderParams.HeightmapSectionTable = HeightmapArray->SectionTable_GPU.SRV;
+	}
+	else {
+		LandscapeGpuRenderParams.HeightmapArray = 0;
+		LandscapeGpuRenderParams.HeightmapArrayParameter = FIntVector4(0, 0, 0, 0);
+		LandscapeGpuRenderParams.HeightmapTextureArray = GBlackArrayTexture->TextureRHI;
+		LandscapeGpuRenderParams.HeightmapSectionTable = GWhiteVertexBufferWithSRV->ShaderResourceViewRHI; //Never read
+	}
 
 	if (!LandscapeGpuRenderUniformBuffer.IsValid()) {
 		LandscapeGpuRenderUniformBuffer = TUniformBufferRef<FLandscapeGpuRenderUniformBuffer>::CreateUniformBufferImmediate(LandscapeGpuRenderParams, UniformBuffer_MultiFrame);
@@ -400,46 +667,129 @@ void FLandscapeGpuRenderProxyComponentSceneProxy::OnTransformChanged() {
 		LandscapeGpuRenderUniformBuffer.UpdateUniformBufferImmediate(LandscapeGpuRenderParams);
 	}	
 
-	//Upload the UniformBuffer to GpuRenderProxyComponent
-	FLandscapeGpuRenderProxyComponent_RenderThread& GpuRenderDataRef = FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderComponent_RenderThread(UniqueWorldId, LandscapeKey);
-	GpuRenderDataRef.LandscapeGpuRenderUserData.LandscapeGpuRenderUniformBuffer = LandscapeGpuRenderUniformBuffer.GetReference();
+	LandscapeGpuRenderUserData.LandscapeGpuRenderUniformBuffer = LandscapeGpuRenderUniformBuffer.GetReference();
+	VirtualTextureUserData.LandscapeGpuRenderUniformBuffer = LandscapeGpuRenderUniformBuffer.GetReference();
 }
 
 void FLandscapeGpuRenderProxyComponentSceneProxy::CreateRenderThreadResources() {
-	check(VertexBuffer == nullptr);
-	check(IndexBuffers.Num() == 0);
-	check(VertexFactory == nullptr);
+	check(SharedBuffers == nullptr);
 
-	//Create and init VertexBuffer
-	VertexBuffer = new FLandscapeClusterVertexBuffer(); //Construct call InitResource
+	//The cluster mesh is shared by all the landscapes, no buffer is created here after the first proxy
+	auto FeatureLevel = GetScene().GetFeatureLevel();
+	SharedBuffers = FLandscapeGpuRenderSharedBuffers::Acquire(FeatureLevel, bStitchingIndexBuffer);
+
+	//Let the render component recache our draw commands when it rebuilds the GPU buffers
+	GpuRenderData = FMobileLandscapeGPURenderSystem_RenderThread::FindLandscapeGPURenderComponentHandle_RenderThread(UniqueWorldId, LandscapeKey);
+	check(GpuRenderData.IsValid());
+	FLandscapeGpuRenderProxyComponent_RenderThread& GpuRenderDataRef = *GpuRenderData;
+	GpuRenderDataRef.SceneProxy = this;
+	GpuRenderDataRef.SetLocalToWorld(GetLocalToWorld());
+
+	//The runtime virtual texture pages have their own culling output, see CullLandscapeGpuVirtualTexturePage
+	if (RuntimeVirtualTextureMaterialTypes.Num() > 0 && !GpuRenderDataRef.bVirtualTexture) {
+		GpuRenderDataRef.bVirtualTexture = true;
+		GpuRenderDataRef.MarkDirty();
+	}
 
-	//Create and init IndexBuffer	
-	static_assert(LandscapeGpuRenderParameter::ClusterQuadSize * LandscapeGpuRenderParameter::ClusterQuadSize * 6 < 0x10000, ""); //Just support int16
-	IndexBuffers.AddZeroed(LandscapeGpuRenderParameter::ClusterLodCount);
-	FLandscapeGpuRenderProxyComponentSceneProxy::CreateClusterIndexBuffers<uint16>(IndexBuffers);
+	//The Lod histogram is resolved on the render thread, the streaming data is updated on the game thread
+	TWeakObjectPtr<ULandscapeGpuRenderProxyComponent> WeakOwnerComponent = OwnerComponent;
+	GpuRenderDataRef.OnFinestDrawnLodChanged = [WeakOwnerComponent](uint32 FinestDrawnLod) {
+		AsyncTask(ENamedThreads::GameThread, [WeakOwnerComponent, FinestDrawnLod]() {
+			if (ULandscapeGpuRenderProxyComponent* Component = WeakOwnerComponent.Get()) {
+				Component->SetStreamingFinestLod(FinestDrawnLod);
+			}
+		});
+	};
 
-	//Create and init VertexFactory
-	auto FeatureLevel = GetScene().GetFeatureLevel();
-	VertexFactory = new FLandscapeGpuRenderVertexFactory(FeatureLevel);
-	VertexFactory->MobileData.PositionComponent = FVertexStreamComponent(VertexBuffer, 0, sizeof(FLandscapeClusterVertex), /*VET_UByte4N*/VET_Float2);
-	VertexFactory->InitResource();
+	//The cluster arrays arrive and are released after the proxy is created
+	GpuRenderDataRef.OnAllocatedSizeChanged = [this]() { UpdateMemoryStats(); };
+	UpdateMemoryStats();
+
+	//Stream the heightmap by pages, OnTransformChanged ran before the atlas exists
+	if (VirtualHeightmapBulkData) {
+		VirtualHeightmap = new FLandscapeVirtualHeightmap_RenderThread(VirtualHeightmapBulkData, SectionSizeQuads + 1, VirtualHeightmapNumSectionPages);
+		GpuRenderDataRef.VirtualHeightmap = VirtualHeightmap;
+		UpdateLandscapeGpuRenderUniformBuffer();
+	}
+	else if (HeightmapArrayTextures.Num() > 0) {
+		//The references follow the streaming reallocations, the slices are copied before the culling
+		TArray<FTextureReferenceRHIRef> HeightmapReferences;
+		for (UTexture2D* SliceTexture : HeightmapArrayTextures) {
+			HeightmapReferences.Emplace(SliceTexture->TextureReference.TextureReferenceRHI);
+		}
+		HeightmapArray = new FLandscapeHeightmapArray_RenderThread(HeightmapReferences, HeightmapArraySizes, SectionHeightmaps, SectionTexels);
+		GpuRenderDataRef.HeightmapArray = HeightmapArray;
+		UpdateLandscapeGpuRenderUniformBuffer();
+	}
+
+	//The grass CS samples the heightmap through the uniform buffer of the proxy
+	if (GrassVarieties.Num() > 0) {
+		TArray<FTextureReferenceRHIRef> WeightmapReferences;
+		for (UTexture2D* Weightmap : GrassWeightmaps) {
+			WeightmapReferences.Emplace(Weightmap->TextureReference.TextureReferenceRHI);
+		}
+		Grass = new FLandscapeGpuGrass_RenderThread(GrassVarieties, GrassDraws, WeightmapReferences, FIntPoint(GrassWeightmaps[0]->GetSizeX(), GrassWeightmaps[0]->GetSizeY()));
+		Grass->InvLandscapeScale = FVector(1.f, 1.f, 1.f) / GetLocalToWorld().GetScaleVector();
+
+		for (int32 VarietyIndex = 0; VarietyIndex < GrassVarieties.Num(); ++VarietyIndex) {
+			//Same streams as FInstancedStaticMeshRenderData::InitVertexFactories, the instances come from the grass instance buffer
+			const FStaticMeshLODResources& LODResources = GrassMeshRenderData[VarietyIndex]->LODResources[GrassMeshLods[VarietyIndex]];
+			FInstancedStaticMeshVertexFactory* GrassVertexFactory = new FInstancedStaticMeshVertexFactory(FeatureLevel);
+			FInstancedStaticMeshVertexFactory::FDataType Data;
+			LODResources.VertexBuffers.PositionVertexBuffer.BindPositionVertexBuffer(GrassVertexFactory, Data);
+			LODResources.VertexBuffers.StaticMeshVertexBuffer.BindTangentVertexBuffer(GrassVertexFactory, Data);
+			LODResources.VertexBuffers.StaticMeshVertexBuffer.BindPackedTexCoordVertexBuffer(GrassVertexFactory, Data);
+			LODResources.VertexBuffers.ColorVertexBuffer.BindColorVertexBuffer(GrassVertexFactory, Data);
+
+			const uint32 InstanceStride = LandscapeGpuRenderParameter::GrassInstanceStride;
+			Data.InstanceOriginComponent = FVertexStreamComponent(&Grass->InstanceBuffer, 0, InstanceStride, VET_Float4, EVertexStreamUsage::Instancing);
+			Data.InstanceTransformComponent[0] = FVertexStreamComponent(&Grass->InstanceBuffer, sizeof(FVector4), InstanceStride, VET_Float4, EVertexStreamUsage::Instancing);
+			Data.InstanceTransformComponent[1] = FVertexStreamComponent(&Grass->InstanceBuffer, 2 * sizeof(FVector4), InstanceStride, VET_Float4, EVertexStreamUsage::Instancing);
+			Data.InstanceTransformComponent[2] = FVertexStreamComponent(&Grass->InstanceBuffer, 3 * sizeof(FVector4), InstanceStride, VET_Float4, EVertexStreamUsage::Instancing);
+			Data.InstanceLightmapAndShadowMapUVBiasComponent = FVertexStreamComponent(&Grass->InstanceBuffer, 4 * sizeof(FVector4), InstanceStride, VET_Float4, EVertexStreamUsage::Instancing);
+			GrassVertexFactory->SetData(Data);
+			GrassVertexFactory->InitResource();
+			GrassVertexFactories.Emplace(GrassVertexFactory);
+		}
+
+		GpuRenderDataRef.Grass = Grass;
+		GpuRenderDataRef.LandscapeGpuRenderUserData.LandscapeGpuRenderUniformBuffer = LandscapeGpuRenderUniformBuffer.GetReference();
+	}
 }
 
 void FLandscapeGpuRenderProxyComponentSceneProxy::DestroyRenderThreadResources() {
-	ensure(VertexFactory != nullptr);
-	ensure(VertexBuffer != nullptr);
-	ensure(IndexBuffers.Num() == LandscapeGpuRenderParameter::ClusterLodCount);
+	ensure(SharedBuffers != nullptr);
+
+	//The render component may be unregistered before the proxy, the handle keeps it alive until here
+	if (GpuRenderData.IsValid() && GpuRenderData->SceneProxy == this) {
+		GpuRenderData->SceneProxy = nullptr;
+		GpuRenderData->OnFinestDrawnLodChanged = nullptr;
+		GpuRenderData->OnAllocatedSizeChanged = nullptr;
+		GpuRenderData->VirtualHeightmap = nullptr;
+		GpuRenderData->HeightmapArray = nullptr;
+		GpuRenderData->Grass = nullptr;
+		GpuRenderData->LandscapeGpuRenderUserData.LandscapeGpuRenderUniformBuffer = nullptr;
+	}
+	GpuRenderData.Reset();
+	UpdateMemoryStats();
 
-	delete VertexFactory;
-	VertexFactory = nullptr;
+	for (FInstancedStaticMeshVertexFactory* GrassVertexFactory : GrassVertexFactories) {
+		GrassVertexFactory->ReleaseResource();
+		delete GrassVertexFactory;
+	}
+	GrassVertexFactories.Empty();
 
-	delete VertexBuffer;
-	VertexBuffer = nullptr;
+	delete Grass;
+	Grass = nullptr;
 
-	for (int32 i = 0; i < IndexBuffers.Num(); i++) {
-		IndexBuffers[i]->ReleaseResource();
-		delete IndexBuffers[i];
-	}
+	delete VirtualHeightmap;
+	VirtualHeightmap = nullptr;
+
+	delete HeightmapArray;
+	HeightmapArray = nullptr;
+
+	SharedBuffers->ReleaseShared();
+	SharedBuffers = nullptr;
 }
 
 void FLandscapeGpuRenderProxyComponentSceneProxy::OnLevelAddedToWorld() {
@@ -450,39 +800,36 @@ FPrimitiveViewRelevance FLandscapeGpuRenderProxyComponentSceneProxy::GetViewRele
 	FPrimitiveViewRelevance Result;
 	//const bool bCollisionView = (View->Family->EngineShowFlags.CollisionVisibility || View->Family->EngineShowFlags.CollisionPawn);
 	//Result.bDrawRelevance = (IsShown(View) || bCollisionView) && View->Family->EngineShowFlags.Landscape;
-	Result.bDrawRelevance = IsShown(View) && View->Family->EngineShowFlags.Landscape;
+	Result.bDrawRelevance = IsShown(View) && View->Family->EngineShowFlags.Landscape && !View->bIsSceneCapture; //GPU culling just runs for the main view
 	Result.bRenderInMainPass = ShouldRenderInMainPass();
 	Result.bRenderCustomDepth = ShouldRenderCustomDepth();
 	Result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
 	Result.bTranslucentSelfShadow = bCastVolumetricTranslucentShadow;
-	Result.bDynamicRelevance = true;
-	Result.bStaticRelevance = false;
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	Result.bDynamicRelevance = View->Family->EngineShowFlags.Bounds; //Just for the cluster bounds
+#else
+	Result.bDynamicRelevance = false;
+#endif
+	Result.bStaticRelevance = true;
 	Result.bShadowRelevance = IsShadowCast(View) && View->Family->EngineShowFlags.Landscape;
 	return Result;
 }
 
-void FLandscapeGpuRenderProxyComponentSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const {
-	if (Views[0]->bIsSceneCapture) {
-		return;
+void FLandscapeGpuRenderProxyComponentSceneProxy::DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) {
+	check(GpuRenderData.IsValid());
+	const FLandscapeGpuRenderProxyComponent_RenderThread& GpuRenderDataRef = *GpuRenderData;
+	if (GpuRenderDataRef.IndirectDrawCommandBuffer_GPU.Buffer == nullptr) {
+		return; //GPU buffers are not built yet, UpdateAllGPUBuffer will recache the draw commands
 	}
 
-	UMaterialInterface* MaterialInterface = AvailableMaterials[0];
-	const auto& GpuRenderData = FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderComponent_RenderThread(UniqueWorldId, LandscapeKey);
+	//The cached mesh draw commands keep a pointer to the UserData, so use the copy owned by the proxy
+	LandscapeGpuRenderUserData.LandscapeGpuRenderOutputBufferSRV = GpuRenderDataRef.LandscapeGpuRenderUserData.LandscapeGpuRenderOutputBufferSRV;
+	LandscapeGpuRenderUserData.LandscapeGpuRenderFirstIndexSRV = GpuRenderDataRef.LandscapeGpuRenderUserData.LandscapeGpuRenderFirstIndexSRV;
 
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-	if (ViewFamily.EngineShowFlags.Bounds) {
-		FColor StartingColor = FColor(100, 0, 0);
-		for (const FBoxSphereBounds& DrawBounds : GpuRenderData.WorldClusterBounds) {		
-			DrawWireBox(Collector.GetPDI(0), DrawBounds.GetBox(), StartingColor, SDPG_World);
-			StartingColor.R += 5;
-			StartingColor.G += 5;
-			StartingColor.B += 5;
-		}		
-	}
-#endif
-	for (int LodIndex = 0; LodIndex < LandscapeGpuRenderParameter::ClusterLodCount; ++LodIndex) {
-		FMeshBatch& MeshBatch = Collector.AllocateMesh();
-		MeshBatch.VertexFactory = VertexFactory;
+	//Cached mesh draw commands only allow one element per batch, so every draw bucket has its own batch
+	auto DrawBucketMesh = [this, PDI, &GpuRenderDataRef](uint32 DrawBucket, uint32 LodIndex, UMaterialInterface* MaterialInterface) {
+		FMeshBatch MeshBatch;
+		MeshBatch.VertexFactory = SharedBuffers->VertexFactory;
 		MeshBatch.MaterialRenderProxy = MaterialInterface->GetRenderProxy();
 		MeshBatch.LCI = nullptr; //don't need to any bake info
 		MeshBatch.ReverseCulling = IsLocalToWorldDeterminantNegative();
@@ -497,22 +844,156 @@ void FLandscapeGpuRenderProxyComponentSceneProxy::GetDynamicMeshElements(const T
 		MeshBatch.bCanApplyViewModeOverrides = true; //兼容WireFrame等
 		//MeshBatch.bUseWireframeSelectionColoring = IsSelected(); //选中颜色
 
-		// Combined batch element
 		FMeshBatchElement& BatchElement = MeshBatch.Elements[0];
-		BatchElement.UserData = &GpuRenderData.LandscapeGpuRenderUserData;
+		BatchElement.UserData = &LandscapeGpuRenderUserData;
 		BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
-		BatchElement.IndexBuffer = IndexBuffers[LodIndex];
+		BatchElement.IndexBuffer = SharedBuffers->IndexBuffer;
 		BatchElement.NumPrimitives = 0; //Use indirect
-		BatchElement.FirstIndex = 0; //Use IndirectArgs don't need
+		BatchElement.FirstIndex = LandscapeGpuRenderParameter::GetDrawBucketFirstIndex(DrawBucket, bStitchingIndexBuffer); //Use IndirectArgs, keep it for debugging
 		BatchElement.MinVertexIndex = 0; //Use IndirectArgs don't need
 		BatchElement.MaxVertexIndex = 0; //Use IndirectArgs don't need
 		BatchElement.NumInstances = 0;  //Use IndirectArgs don't need
 		BatchElement.InstancedLODIndex = 0; //用来传递LOD, don't need
-		BatchElement.IndirectArgsBuffer = GpuRenderData.IndirectDrawCommandBuffer_GPU.Buffer;
-		BatchElement.IndirectArgsOffset = LodIndex * sizeof(FDrawIndirectCommandArgs_CPU);
+		BatchElement.IndirectArgsBuffer = GpuRenderDataRef.IndirectDrawCommandBuffer_GPU.Buffer;
+		BatchElement.IndirectArgsOffset = DrawBucket * sizeof(FDrawIndirectCommandArgs_CPU);
+
+		BatchElement.UserIndex = DrawBucket; //Draw bucket, the VF uses it to find the instance offset
+
+		PDI->DrawMesh(MeshBatch, FLT_MAX);
+	};
+
+	//With one material for all the Lods, the solid buckets are drawn at once over the Lod0 indices, see LandscapeGpuRenderParameter::UnifiedDrawBucket
+	bool bUnifiedDraw = !bStitchingIndexBuffer && CVarMobileLandscapeUnifiedDraw.GetValueOnAnyThread() != 0;
+	for (uint32 LodIndex = 1; LodIndex < LandscapeGpuRenderParameter::ClusterLodCount; ++LodIndex) {
+		bUnifiedDraw &= ClusterLodToMaterialIndex[LodIndex] == ClusterLodToMaterialIndex[0];
+	}
+	if (bUnifiedDraw) {
+		DrawBucketMesh(LandscapeGpuRenderParameter::UnifiedDrawBucket, 0, AvailableMaterials[ClusterLodToMaterialIndex[0]]);
+	}
+
+	//The hole variants are empty without partially hole clusters, so skip them
+	const uint32 NumDrawBuckets = GpuRenderDataRef.bHasPartialHoleClusters
+		? LandscapeGpuRenderParameter::GetDrawBucketCount(bStitchingIndexBuffer)
+		: LandscapeGpuRenderParameter::GetSolidDrawBucketCount(bStitchingIndexBuffer);
+	const uint32 FirstDrawBucket = bUnifiedDraw ? LandscapeGpuRenderParameter::GetSolidDrawBucketCount(false) : 0;
+	for (uint32 DrawBucket = FirstDrawBucket; DrawBucket < NumDrawBuckets; ++DrawBucket) {
+		//Far clusters can use a cheaper material, see LODIndexToMaterialIndex, the partially hole clusters use the masked one
+		const uint32 LodIndex = LandscapeGpuRenderParameter::GetDrawBucketLod(DrawBucket, bStitchingIndexBuffer);
+		const bool bHoleDrawBucket = LandscapeGpuRenderParameter::IsHoleDrawBucket(DrawBucket, bStitchingIndexBuffer) && AvailableHoleMaterials.Num() > 0;
+		UMaterialInterface* MaterialInterface = bHoleDrawBucket ? AvailableHoleMaterials[ClusterLodToHoleMaterialIndex[LodIndex]] : AvailableMaterials[ClusterLodToMaterialIndex[LodIndex]];
+		DrawBucketMesh(DrawBucket, LodIndex, MaterialInterface);
+	}
+
+	//Runtime virtual texture pages, every cluster of a page has the same Lod, so just the buckets without a stitched edge are filled
+	if (GpuRenderDataRef.VirtualTextureIndirectDrawCommandBuffer_GPU.Buffer) {
+		VirtualTextureUserData.LandscapeGpuRenderOutputBufferSRV = GpuRenderDataRef.VirtualTextureUserData.LandscapeGpuRenderOutputBufferSRV;
+		VirtualTextureUserData.LandscapeGpuRenderFirstIndexSRV = GpuRenderDataRef.VirtualTextureUserData.LandscapeGpuRenderFirstIndexSRV;
+
+		const uint32 DrawBucketStride = bStitchingIndexBuffer ? LandscapeGpuRenderParameter::ClusterEdgeMaskCount : 1;
+		for (ERuntimeVirtualTextureMaterialType MaterialType : RuntimeVirtualTextureMaterialTypes) {
+			for (uint32 DrawBucket = 0; DrawBucket < NumDrawBuckets; DrawBucket += DrawBucketStride) {
+				const uint32 LodIndex = LandscapeGpuRenderParameter::GetDrawBucketLod(DrawBucket, bStitchingIndexBuffer);
+				const bool bHoleDrawBucket = LandscapeGpuRenderParameter::IsHoleDrawBucket(DrawBucket, bStitchingIndexBuffer) && AvailableHoleMaterials.Num() > 0;
+				UMaterialInterface* MaterialInterface = bHoleDrawBucket ? AvailableHoleMaterials[ClusterLodToHoleMaterialIndex[LodIndex]] : AvailableMaterials[ClusterLodToMaterialIndex[LodIndex]];
+
+				FMeshBatch MeshBatch;
+				MeshBatch.VertexFactory = SharedBuffers->VertexFactory;
+				MeshBatch.MaterialRenderProxy = MaterialInterface->GetRenderProxy();
+				MeshBatch.LCI = nullptr;
+				MeshBatch.ReverseCulling = IsLocalToWorldDeterminantNegative();
+				MeshBatch.CastShadow = false;
+				MeshBatch.bUseForDepthPass = false;
+				MeshBatch.bUseAsOccluder = false;
+				MeshBatch.bUseForMaterial = false;
+				MeshBatch.Type = PT_TriangleList;
+				MeshBatch.DepthPriorityGroup = SDPG_World;
+				MeshBatch.LODIndex = 0; //The page Lod is picked by CullLandscapeGpuVirtualTexturePage
+				MeshBatch.bDitheredLODTransition = false;
+				MeshBatch.bRenderToVirtualTexture = true;
+				MeshBatch.RuntimeVirtualTextureMaterialType = (uint32)MaterialType;
+
+				FMeshBatchElement& BatchElement = MeshBatch.Elements[0];
+				BatchElement.UserData = &VirtualTextureUserData;
+				BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+				BatchElement.IndexBuffer = SharedBuffers->IndexBuffer;
+				BatchElement.NumPrimitives = 0; //Use indirect
+				BatchElement.FirstIndex = LandscapeGpuRenderParameter::GetDrawBucketFirstIndex(DrawBucket, bStitchingIndexBuffer);
+				BatchElement.MinVertexIndex = 0;
+				BatchElement.MaxVertexIndex = 0;
+				BatchElement.NumInstances = 0;
+				BatchElement.InstancedLODIndex = 0;
+				BatchElement.IndirectArgsBuffer = GpuRenderDataRef.VirtualTextureIndirectDrawCommandBuffer_GPU.Buffer;
+				BatchElement.IndirectArgsOffset = DrawBucket * sizeof(FDrawIndirectCommandArgs_CPU);
+				BatchElement.UserIndex = DrawBucket;
+
+				PDI->DrawMesh(MeshBatch, FLT_MAX);
+			}
+		}
+	}
+
+	//Grass, one batch per mesh section, the instance count is written by the grass CS
+	for (int32 DrawIndex = 0; Grass && DrawIndex < GrassDraws.Num(); ++DrawIndex) {
+		const FLandscapeGpuGrassDraw& GrassDraw = GrassDraws[DrawIndex];
+		const FStaticMeshLODResources& LODResources = GrassMeshRenderData[GrassDraw.Variety]->LODResources[GrassMeshLods[GrassDraw.Variety]];
+
+		FMeshBatch MeshBatch;
+		MeshBatch.VertexFactory = GrassVertexFactories[GrassDraw.Variety];
+		MeshBatch.MaterialRenderProxy = GrassDrawMaterials[DrawIndex]->GetRenderProxy();
+		MeshBatch.LCI = nullptr;
+		MeshBatch.ReverseCulling = IsLocalToWorldDeterminantNegative();
+		MeshBatch.CastShadow = false;
+		MeshBatch.bUseForDepthPass = true;
+		MeshBatch.bUseAsOccluder = false;
+		MeshBatch.bUseForMaterial = true;
+		MeshBatch.Type = PT_TriangleList;
+		MeshBatch.DepthPriorityGroup = SDPG_World;
+		MeshBatch.LODIndex = GrassMeshLods[GrassDraw.Variety];
+		MeshBatch.bDitheredLODTransition = false;
+		MeshBatch.bCanApplyViewModeOverrides = true;
+
+		FMeshBatchElement& BatchElement = MeshBatch.Elements[0];
+		BatchElement.UserData = &GrassUserData[GrassDraw.Variety];
+		BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+		BatchElement.IndexBuffer = &LODResources.IndexBuffer;
+		BatchElement.NumPrimitives = 0; //Use indirect
+		BatchElement.FirstIndex = GrassDraw.FirstIndex; //Use IndirectArgs, keep it for debugging
+		BatchElement.MinVertexIndex = 0;
+		BatchElement.MaxVertexIndex = LODResources.GetNumVertices() - 1;
+		BatchElement.NumInstances = 0; //Use IndirectArgs don't need
+		BatchElement.IndirectArgsBuffer = Grass->DrawArgs_GPU.Buffer;
+		BatchElement.IndirectArgsOffset = DrawIndex * sizeof(FDrawIndirectCommandArgs_CPU);
+
+		BatchElement.UserIndex = Grass->GetFirstInstance(GrassDraw.Variety); //The VF offsets the instance streams by it
+
+		PDI->DrawMesh(MeshBatch, FLT_MAX);
+	}
+}
 
-		BatchElement.UserIndex = LodIndex; // Test
+void FLandscapeGpuRenderProxyComponentSceneProxy::UpdateMemoryStats() {
+	check(IsInRenderingThread());
+	const SIZE_T CPUMemory = GpuRenderData.IsValid() ? GpuRenderData->GetCPUAllocatedSize() : 0;
+	const SIZE_T GPUMemory = GpuRenderData.IsValid() ? GpuRenderData->GetGPUAllocatedSize() : 0;
+	DEC_MEMORY_STAT_BY(STAT_LandscapeGpuRenderCPUMem, ReportedCPUMemory);
+	DEC_MEMORY_STAT_BY(STAT_LandscapeGpuRenderGPUMem, ReportedGPUMemory);
+	INC_MEMORY_STAT_BY(STAT_LandscapeGpuRenderCPUMem, CPUMemory);
+	INC_MEMORY_STAT_BY(STAT_LandscapeGpuRenderGPUMem, GPUMemory);
+	ReportedCPUMemory = CPUMemory;
+	ReportedGPUMemory = GPUMemory;
+}
 
-		Collector.AddMesh(0, MeshBatch);
+void FLandscapeGpuRenderProxyComponentSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const {
+	//The clusters are drawn by the cached static mesh draw commands, here is just debug drawing
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if (ViewFamily.EngineShowFlags.Bounds && GpuRenderData.IsValid()) {
+		//Empty until the GPU copy is read back once the CPU ranges are released
+		const TArray<uint32>& ClusterHeightRanges = GpuRenderData->GetDebugClusterHeightRanges();
+		FColor StartingColor = FColor(100, 0, 0);
+		for (int32 ClusterIndex = 0; ClusterIndex < ClusterHeightRanges.Num(); ++ClusterIndex) {
+			DrawWireBox(Collector.GetPDI(0), GetLocalToWorld(), GpuRenderData->GetLocalClusterBox(ClusterIndex, ClusterHeightRanges[ClusterIndex]), StartingColor, SDPG_World);
+			StartingColor.R += 5;
+			StartingColor.G += 5;
+			StartingColor.B += 5;
+		}		
 	}
+#endif
 }
\ No newline at end of file
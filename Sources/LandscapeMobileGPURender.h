@@ -7,17 +7,27 @@
 #include "LandscapeRender.h"
 #include "Runtime/Landscape/Private/LandscapePrivate.h"
 #include "LandscapeMobileGPURenderEngine.h"
+#include "InstancedStaticMesh.h"
 
 class ULandscapeGpuRenderProxyComponent;
+class ALandscapeProxy;
 struct FLandscapeClusterVertex;
 
 BEGIN_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeGpuRenderUniformBuffer, LANDSCAPE_API)
 	SHADER_PARAMETER(int32, NumClusterPerSection)
+	SHADER_PARAMETER(int32, StitchingIndexBuffer)
+	SHADER_PARAMETER(int32, VirtualHeightmap)
+	SHADER_PARAMETER(FIntVector4, VirtualHeightmapParameter) //(NumSectionPagesX, NumSectionPagesY, SlotsPerRow, 0)
+	SHADER_PARAMETER(int32, HeightmapArray)
+	SHADER_PARAMETER(FIntVector4, HeightmapArrayParameter) //(NumSectionsX, NumSectionsY, 0, 0)
 	SHADER_PARAMETER(FVector2D, QuadSizeParameter)
 	SHADER_PARAMETER(FVector4, HeightmapUVParameter)
 	SHADER_PARAMETER(FMatrix, LocalToWorldNoScaling)
 	SHADER_PARAMETER_TEXTURE(Texture2D, HeightmapTexture)
 	SHADER_PARAMETER_SAMPLER(SamplerState, HeightmapTextureSampler)
+	SHADER_PARAMETER_SRV(Buffer<uint>, VirtualHeightmapPageTable)
+	SHADER_PARAMETER_TEXTURE(Texture2DArray, HeightmapTextureArray)
+	SHADER_PARAMETER_SRV(Buffer<uint>, HeightmapSectionTable) //See LandscapeGpuRenderParameter::PackHeightmapArraySection
 END_GLOBAL_SHADER_PARAMETER_STRUCT()
 
 //Submit to landscape data
@@ -35,8 +45,14 @@ struct FMobileLandscapeGPURenderSystem_GameThread {
 	FMobileLandscapeGPURenderSystem_GameThread(/*uint32 NumComponents*/);
 	~FMobileLandscapeGPURenderSystem_GameThread();
 	static void RegisterGPURenderLandscapeEntity(ULandscapeComponent* InstanceComponent);
+	static void RegisterGPURenderLandscapeProxy(ALandscapeProxy* LandscapeProxy); //Its deferred components in one batch, from PostRegisterAllComponents
 	static void UnRegisterGPURenderLandscapeEntity(ULandscapeComponent* InstanceComponent);
-	static TMap<uint32, FMobileLandscapeGPURenderSystem_GameThread*> LandscapeGPURenderSystem_GameThread;
+	static TMap<uint32, TUniquePtr<FMobileLandscapeGPURenderSystem_GameThread>> LandscapeGPURenderSystem_GameThread;
+
+private:
+	static void RegisterGPURenderLandscapeEntities(TArrayView<ULandscapeComponent* const> LandscapeComponents); //Components of the same proxy
+
+public:
 	
 	//[GameThread]
 	uint32 NumAllRegisterComponents_GameThread; //the sum of the Entity numbers of all Landscapes, note that System may have multiple Landscapes
@@ -92,7 +108,7 @@ private:
 	/** stream component data bound to this vertex factory */
 	FDataType MobileData;
 
-	friend class FLandscapeGpuRenderProxyComponentSceneProxy;
+	friend class FLandscapeGpuRenderSharedBuffers;
 };
 
 class FLandscapeClusterVertexBuffer : public FVertexBuffer
@@ -105,6 +121,38 @@ public:
 	* Initialize the RHI for this rendering resource
 	*/
 	virtual void InitRHI() override;
+
+private:
+	static uint8 GetVertexEdgeFlags(uint32 VertexCoord);
+};
+
+//The cluster mesh is the same for every landscape, just the index buffer layout follows CVarMobileLandscapeStitchingIndexBuffer
+class FLandscapeGpuRenderSharedBuffers : public FRefCountedObject {
+public:
+	FLandscapeGpuRenderSharedBuffers(uint32 InSharedBuffersKey, ERHIFeatureLevel::Type InFeatureLevel, bool bInStitchingIndexBuffer);
+	virtual ~FLandscapeGpuRenderSharedBuffers();
+
+	static FLandscapeGpuRenderSharedBuffers* Acquire(ERHIFeatureLevel::Type InFeatureLevel, bool bInStitchingIndexBuffer); //AddRef the cached buffers or create them
+	void ReleaseShared(); //The last release removes the buffers from SharedBuffersMap
+	static inline uint32 GetSharedBuffersKey(ERHIFeatureLevel::Type InFeatureLevel, bool bInStitchingIndexBuffer) { return (static_cast<uint32>(InFeatureLevel) << 1) | (bInStitchingIndexBuffer ? 1 : 0); }
+
+	static TMap<uint32, FLandscapeGpuRenderSharedBuffers*> SharedBuffersMap; //Render thread only, shared by the proxies of all worlds
+
+	//[Resources Value]
+	uint32 SharedBuffersKey;
+
+	//[Resources Manager]
+	FLandscapeGpuRenderVertexFactory* VertexFactory;
+
+	//[Resources Manager]
+	FLandscapeClusterVertexBuffer* VertexBuffer;
+
+	//[Resources Manager]
+	FIndexBuffer* IndexBuffer; //All Lods, see LandscapeGpuRenderParameter::GetLodFirstIndex
+
+private:
+	template <typename IndexType>
+	static FIndexBuffer* CreateClusterIndexBuffer(bool bInStitchingIndexBuffer);
 };
 
 class FLandscapeGpuRenderProxyComponentSceneProxy final : public FPrimitiveSceneProxy {
@@ -118,14 +166,17 @@ public:
 	//[Resources Value]
 	uint32 SectionSizeQuads;
 
-	//[Resources Manager]
-	FLandscapeGpuRenderVertexFactory* VertexFactory;
+	//[Resources Value]
+	bool bStitchingIndexBuffer; //See CVarMobileLandscapeStitchingIndexBuffer
 
-	//[Resources Manager]
-	FLandscapeClusterVertexBuffer* VertexBuffer;
+	//[Resources Ref]
+	FLandscapeGpuRenderSharedBuffers* SharedBuffers; //Vertex factory, vertex and index buffers, refcounted by the proxies
 
-	//[Resources Manager]
-	TArray<FIndexBuffer*> IndexBuffers;
+	//[Resources Value]
+	FLandscapeGpuRenderUserData LandscapeGpuRenderUserData; //The cached mesh draw commands point to it, so it must live as long as the proxy
+
+	//[Resources Value]
+	FLandscapeGpuRenderUserData VirtualTextureUserData; //Same for the runtime virtual texture page draws
 
 	//[Resources Manager, Auto Release]
 	TUniformBufferRef<FLandscapeGpuRenderUniformBuffer> LandscapeGpuRenderUniformBuffer;
@@ -134,14 +185,84 @@ public:
 	//[Resources Value]
 	FGuid LandscapeKey;
 
+	//[Resources Ref]
+	TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe> GpuRenderData; //Set by CreateRenderThreadResources, no map lookup per frame and it outlives the unregistration
+
+	//[Resources Ref]
+	TWeakObjectPtr<ULandscapeGpuRenderProxyComponent> OwnerComponent; //Just dereferenced on the game thread
+
 	//[Resources Ref]
 	UTexture2D* HeightmapTexture; // PC : Heightmap, Mobile : Weightmap
 
+	//[Resources Ref]
+	const FByteBulkData* VirtualHeightmapBulkData; //Pages of ULandscapeGpuVirtualHeightmap, null if the heightmap is sampled directly
+
+	//[Resources Value]
+	FIntPoint VirtualHeightmapNumSectionPages;
+
+	//[Resources Manager]
+	FLandscapeVirtualHeightmap_RenderThread* VirtualHeightmap;
+
+	//[Resources Ref]
+	TArray<UTexture2D*> HeightmapArrayTextures; //Slices of HeightmapArray, empty if the landscape has one heightmap
+
+	//[Resources Value]
+	TArray<FIntPoint> HeightmapArraySizes;
+
+	//[Resources Value]
+	TArray<uint32> SectionHeightmaps; //Section -> Slice
+
+	//[Resources Value]
+	TArray<FIntPoint> SectionTexels; //Section -> Texel of its first vertex in the heightmap
+
+	//[Resources Value]
+	FIntPoint NumSections;
+
+	//[Resources Manager]
+	FLandscapeHeightmapArray_RenderThread* HeightmapArray;
+
 	//[Resources Ref]
 	TArray<UMaterialInterface*> AvailableMaterials;//Mobile Material, 
 
-	template <typename IndexType>
-	static void CreateClusterIndexBuffers(TArray<FIndexBuffer*>& InIndexBuffers);
+	//[Resources Value]
+	uint8 ClusterLodToMaterialIndex[LandscapeGpuRenderParameter::ClusterLodCount]; //Index of AvailableMaterials, per cluster Lod
+
+	//[Resources Ref]
+	TArray<UMaterialInterface*> AvailableHoleMaterials; //Masked material of the components with holes, empty if none
+
+	//[Resources Value]
+	uint8 ClusterLodToHoleMaterialIndex[LandscapeGpuRenderParameter::ClusterLodCount]; //Index of AvailableHoleMaterials, per cluster Lod
+
+	//[Resources Value]
+	TArray<FLandscapeGpuGrassVariety> GrassVarieties;
+
+	//[Resources Value]
+	TArray<FLandscapeGpuGrassDraw> GrassDraws; //One per mesh section of every grass variety
+
+	//[Resources Ref]
+	TArray<UMaterialInterface*> GrassDrawMaterials; //Per grass draw
+
+	//[Resources Ref]
+	TArray<FStaticMeshRenderData*> GrassMeshRenderData; //Per grass variety
+
+	//[Resources Value]
+	TArray<int32> GrassMeshLods; //Per grass variety
+
+	//[Resources Ref]
+	TArray<UTexture2D*> GrassWeightmaps;
+
+	//[Resources Value]
+	TArray<FInstancingUserData> GrassUserData; //Per grass variety, the cached mesh draw commands point to it
+
+	//[Resources Manager]
+	TArray<FInstancedStaticMeshVertexFactory*> GrassVertexFactories; //Per grass variety, the instance streams are written by the grass CS
+
+	//[Resources Manager]
+	FLandscapeGpuGrass_RenderThread* Grass;
+
+	//[Resources Value]
+	SIZE_T ReportedCPUMemory; //Last sizes of GpuRenderData added to the landscape memory stats, written on the render thread
+	SIZE_T ReportedGPUMemory;
 
 	SIZE_T GetTypeHash() const override;
 	FLandscapeGpuRenderProxyComponentSceneProxy(ULandscapeGpuRenderProxyComponent* InComponent);
@@ -149,16 +270,24 @@ public:
 
 	// FPrimitiveSceneProxy interface.
 	virtual void ApplyWorldOffset(FVector InOffset) override;
-	//virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override; assume all is dynamic
+	virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override;
 	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override;
-	virtual uint32 GetMemoryFootprint() const override { return(sizeof(*this) + GetAllocatedSize()); }
+	virtual uint32 GetMemoryFootprint() const override { return(sizeof(*this) + GetAllocatedSize() + ReportedCPUMemory); }
 	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override;
 	virtual bool CanBeOccluded() const override;
+	virtual int32 CollectOccluderElements(FOccluderElementsCollector& Collector) const override;
 	virtual void GetLightRelevance(const FLightSceneProxy* LightSceneProxy, bool& bDynamic, bool& bRelevant, bool& bLightMapped, bool& bShadowMapped) const override;
 	virtual void OnTransformChanged() override;
 	virtual void CreateRenderThreadResources() override;
 	virtual void DestroyRenderThreadResources() override;
 	virtual void OnLevelAddedToWorld() override;
+
+	inline SIZE_T GetReportedCPUMemory() const { return ReportedCPUMemory; }
+	inline SIZE_T GetReportedGPUMemory() const { return ReportedGPUMemory; }
+
+private:
+	void UpdateLandscapeGpuRenderUniformBuffer();
+	void UpdateMemoryStats();
 };
 
 
@@ -1,6 +1,9 @@
 #include "LandscapeMobileGPURenderEngine.h"
 #include "LandscapeMobileGPURender.h"
 #include "MobileGpuDriven.h"
+#include "RHIGPUReadback.h"
+
+IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeGpuCullingLandscapeParameters, "LandscapeGpuCullingLandscape");
 
 ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeGpuRender(
 	TEXT("r.GpuDriven.LandscapeGpuRender"),
@@ -16,9 +19,88 @@ ENGINE_API TAutoConsoleVariable<int32> CVarMobileComputeShaderControl(
 	ECVF_Scalability
 );
 
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeStitchingIndexBuffer(
+	TEXT("r.GpuDriven.LandscapeStitchingIndexBuffer"),
+	0,
+	TEXT("0: The vertex shader snaps the edge vertices to the neighbor Lod\n")
+	TEXT("1: Use precomputed index buffer per (Lod, neighbor EdgeMask), the vertex shader just fetches the grid.\n")
+	TEXT("   The vertex shader still snaps the edges of a neighbor more than one Lod coarser"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeUnifiedDraw(
+	TEXT("r.GpuDriven.LandscapeUnifiedDraw"),
+	1,
+	TEXT("1: Without r.GpuDriven.LandscapeStitchingIndexBuffer and with one material for all the Lods, draw the solid clusters in one indirect draw per pass.\n")
+	TEXT("   Every cluster runs the Lod0 vertices and indices, the quads off its Lod grid are degenerate"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeVirtualHeightmap(
+	TEXT("r.GpuDriven.LandscapeVirtualHeightmap"),
+	0,
+	TEXT("1: Stream the heightmap by pages into a fixed atlas, the landscape is not limited to one heightmap.\n")
+	TEXT("   The pages are built when the landscape is saved"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeVirtualHeightmapPoolSize(
+	TEXT("r.GpuDriven.LandscapeVirtualHeightmapPoolSize"),
+	8,
+	TEXT("Pages per side of the virtual heightmap atlas, a page is one section"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeGpuGrass(
+	TEXT("r.GpuDriven.LandscapeGpuGrass"),
+	0,
+	TEXT("1: Spawn the grass of the landscape GpuGrassLayers on the GPU, inside the visible Lod0 and Lod1 clusters.\n")
+	TEXT("   The density comes from the whole weightmaps"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeGpuGrassMaxInstances(
+	TEXT("r.GpuDriven.LandscapeGpuGrassMaxInstances"),
+	32768,
+	TEXT("Max GPU grass instances per grass variety, the extra instances are dropped"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeClusterQuadtree(
+	TEXT("r.GpuDriven.LandscapeClusterQuadtree"),
+	0,
+	TEXT("1: Bake the vertex heights with the cluster bounds, for the CPU height and raycast queries of FLandscapeGpuClusterQuadtree.\n")
+	TEXT("   Costs 2 bytes per landscape vertex"),
+	ECVF_ReadOnly
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeEarlyOccluder(
+	TEXT("r.GpuDriven.LandscapeEarlyOccluder"),
+	0,
+	TEXT("1: Before the GPU culling, build a landscape Hzb from the landscape clusters drawn near the camera last frame, with this frame's view.\n")
+	TEXT("   Only the landscape culling reads it, for same frame terrain occlusion. The mobile Hzb of the other meshes is left as is"),
+	ECVF_Scalability
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeEarlyOccluderMaxLod(
+	TEXT("r.GpuDriven.LandscapeEarlyOccluderMaxLod"),
+	1,
+	TEXT("Coarsest cluster Lod rasterized to the early Hzb, see r.GpuDriven.LandscapeEarlyOccluder"),
+	ECVF_Scalability
+);
+
+ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeOccluderMaxTriangles(
+	TEXT("r.GpuDriven.LandscapeOccluderMaxTriangles"),
+	2048,
+	TEXT("Triangles of the landscape occluder mesh fed every frame to the software occlusion, 0 disables it.\n")
+	TEXT("   The mesh is a grid under the cluster bounds, the clusters are merged into coarser cells to fit the budget"),
+	ECVF_Scalability
+);
+
 
 FLandscapeGpuRenderProxyComponent_RenderThread::FLandscapeGpuRenderProxyComponent_RenderThread()
 	: bLandscapeDirty(false)
+	, bStitchingIndexBuffer(false)
 	, NumSections(0)
 	, ClusterSizePerSection(0)
 	, ClusterSizeX(0)
@@ -27,6 +109,24 @@ FLandscapeGpuRenderProxyComponent_RenderThread::FLandscapeGpuRenderProxyComponen
 	, NumRegisterComponent(0)
 	, LandscapeComponentMin(INT32_MAX, INT32_MAX)
 	, LandscapeComponentSize(FIntPoint(0,0))
+	, LocalToWorld(FMatrix::Identity)
+	, WorldToLocal(FMatrix::Identity)
+	, LandscapeGpuRenderUserData()
+	, SceneProxy(nullptr)
+	, FinestDrawnLod(LandscapeGpuRenderParameter::FirstLod)
+	, VirtualHeightmap(nullptr)
+	, HeightmapArray(nullptr)
+	, Grass(nullptr)
+	, NumInputClusters(0)
+	, bHasPartialHoleClusters(false)
+	, ClusterLodCountReadback(nullptr)
+	, bLodHistogramReadbackPending(false)
+	, ClusterInputReadback(nullptr)
+	, bClusterInputReadbackRequested(false)
+	, bClusterInputReadbackPending(false)
+	, bVirtualTexture(false)
+	, bClusterOutputHistoryValid(false)
+	, VirtualTextureUserData()
 {
 
 }
@@ -40,6 +140,17 @@ FLandscapeGpuRenderProxyComponent_RenderThread::~FLandscapeGpuRenderProxyCompone
 	ClusterLodCountUAV_GPU.Release();
 	OrderClusterOutBufferUAV_GPU.Release();
 	IndirectDrawCommandBuffer_GPU.Release();
+	DrawBucketStart_GPU.Release();
+	CullingUniformBuffer.SafeRelease();
+	delete ClusterLodCountReadback;
+	ClusterLodCountReadback = nullptr;
+	delete ClusterInputReadback;
+	ClusterInputReadback = nullptr;
+	VirtualTextureClusterOutputData_GPU.Release();
+	VirtualTextureClusterLodCount_GPU.Release();
+	VirtualTextureOrderClusterOutBuffer_GPU.Release();
+	VirtualTextureIndirectDrawCommandBuffer_GPU.Release();
+	VirtualTextureDrawBucketStart_GPU.Release();
 }
 
 uint32 FLandscapeGpuRenderProxyComponent_RenderThread::GetLinearIndexByClusterIndex(const FIntPoint& ClusterIndex) const {
@@ -60,31 +171,135 @@ uint32 FLandscapeGpuRenderProxyComponent_RenderThread::GetLinearIndexByClusterIn
 	return Offset_1 + Offset_2;
 }
 
-void FLandscapeGpuRenderProxyComponent_RenderThread::InitClusterData(const TArray<FBox>& ClusterBoundingArray, const FMatrix& LocalToWorldMatrix) {
+void FLandscapeGpuRenderProxyComponent_RenderThread::InitClusterData(TArray<uint32>&& InClusterHeightRanges, TArray<uint8>&& InClusterHoleFlags, const FMatrix& LocalToWorldMatrix) {
 	check(IsInRenderingThread());
-	WorldClusterBounds.SetNumZeroed(ClusterBoundingArray.Num());
-	for (int32 Index = 0; Index < ClusterBoundingArray.Num(); ++Index) {
-		WorldClusterBounds[Index] = FBoxSphereBounds(ClusterBoundingArray[Index]).TransformBy(LocalToWorldMatrix);
-	}
-
-	//Component的位置为所有Bounding叠加在一起的中心位置
+	//The ranges stay in landscape space, moving or rebasing the landscape just changes LocalToWorld
 	const uint32 ClusterSizePerComponent = ClusterSizePerSection * NumSections;
 	const uint32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
+	check(InClusterHeightRanges.Num() == ClusterSqureSizePerComponent * LandscapeComponentSize.X * LandscapeComponentSize.Y);
+	ClusterHeightRanges = MoveTemp(InClusterHeightRanges);
+	NumInputClusters = ClusterHeightRanges.Num();
+	SetLocalToWorld(LocalToWorldMatrix);
+
+	//Same layout as the ranges, the landscapes saved before the hole flags have none
+	check(InClusterHoleFlags.Num() == 0 || InClusterHoleFlags.Num() == ClusterHeightRanges.Num());
+	ClusterHoleFlags = MoveTemp(InClusterHoleFlags);
+	bHasPartialHoleClusters = ClusterHoleFlags.ContainsByPredicate([](uint8 HoleFlags) { return (HoleFlags & LandscapeGpuRenderParameter::ClusterPartialHoleFlag) != 0; });
+
+	//Component的位置为所有Bounding叠加在一起的中心位置
+	ComponentsOriginAndRadius.Reset(); //A build that finished after a re-register may init the component twice
 	for (int32 ComponentY = 0; ComponentY < LandscapeComponentSize.Y; ++ComponentY) {
 		for (int32 ComponentX = 0; ComponentX < LandscapeComponentSize.X; ++ComponentX) {
 			uint32 StartIndex = (ComponentX + ComponentY * LandscapeComponentSize.X) * ClusterSqureSizePerComponent;
 			FBox ComponetnBoxds = FBox(EForceInit::ForceInit);
 			for (uint32 LinearIndex = 0; LinearIndex < ClusterSqureSizePerComponent; ++LinearIndex) {
-				ComponetnBoxds += WorldClusterBounds[StartIndex + LinearIndex].GetBox();
+				ComponetnBoxds += GetLocalClusterBox(StartIndex + LinearIndex, ClusterHeightRanges[StartIndex + LinearIndex]);
 			}
 			FBoxSphereBounds SphereBound = FBoxSphereBounds(ComponetnBoxds);
 			ComponentsOriginAndRadius.Emplace(FVector4(SphereBound.Origin, SphereBound.SphereRadius));
 		}
 	}
+
+	BuildOccluderMesh();
+	MarkDirty();
+	if (OnAllocatedSizeChanged) {
+		OnAllocatedSizeChanged();
+	}
+}
+
+FBox FLandscapeGpuRenderProxyComponent_RenderThread::GetLocalClusterBox(uint32 LinearIndex, uint32 PackedHeightRange) const {
+	const uint32 ClusterSizePerComponent = ClusterSizePerSection * NumSections;
+	const uint32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
+	const uint32 ComponentIndex = LinearIndex / ClusterSqureSizePerComponent;
+	const uint32 LocalClusterIndex = LinearIndex % ClusterSqureSizePerComponent;
+	const FIntPoint GlobalClusterIndex(
+		ComponentIndex % LandscapeComponentSize.X * ClusterSizePerComponent + LocalClusterIndex % ClusterSizePerComponent,
+		ComponentIndex / LandscapeComponentSize.X * ClusterSizePerComponent + LocalClusterIndex / ClusterSizePerComponent
+	);
+	return LandscapeGpuRenderParameter::GetLocalClusterBox(GlobalClusterIndex, ClusterSizePerSection, PackedHeightRange);
+}
+
+void FLandscapeGpuRenderProxyComponent_RenderThread::BuildOccluderMesh() {
+	OccluderVertices.Reset();
+	OccluderIndices.Reset();
+
+	//The grid follows the cluster columns and rows in landscape space, the scene proxy gives LocalToWorld to the software occlusion
+	const int32 MaxTriangles = CVarMobileLandscapeOccluderMaxTriangles.GetValueOnRenderThread();
+	if (MaxTriangles <= 0 || ClusterHeightRanges.Num() == 0) {
+		return;
+	}
+
+	const uint32 ClusterSizePerComponent = ClusterSizePerSection * NumSections;
+	const uint32 ClusterSqureSizePerComponent = ClusterSizePerComponent * ClusterSizePerComponent;
+	const FIntPoint NumClusters = LandscapeComponentSize * ClusterSizePerComponent;
+	auto GetClusterIndex = [&](int32 ClusterX, int32 ClusterY) {
+		return ((ClusterY / ClusterSizePerComponent) * LandscapeComponentSize.X + ClusterX / ClusterSizePerComponent) * ClusterSqureSizePerComponent
+			+ (ClusterY % ClusterSizePerComponent) * ClusterSizePerComponent + ClusterX % ClusterSizePerComponent;
+	};
+
+	//Merge CellSize x CellSize clusters per cell until the grid fits the budget and the 16 bits indices
+	int32 CellSize = 1;
+	FIntPoint NumCells = NumClusters;
+	while ((NumCells.X * NumCells.Y * 2 > MaxTriangles && NumCells.X * NumCells.Y > 1) || (NumCells.X + 1) * (NumCells.Y + 1) > MAX_uint16) {
+		++CellSize;
+		NumCells = FIntPoint(FMath::DivideAndRoundUp(NumClusters.X, CellSize), FMath::DivideAndRoundUp(NumClusters.Y, CellSize));
+	}
+
+	//A cell is at the lowest bottom of its clusters, the cells with a hole are left out
+	TArray<float> CellMinZ;
+	CellMinZ.Init(MAX_flt, NumCells.X * NumCells.Y);
+	for (int32 ClusterY = 0; ClusterY < NumClusters.Y; ++ClusterY) {
+		for (int32 ClusterX = 0; ClusterX < NumClusters.X; ++ClusterX) {
+			const int32 ClusterIndex = GetClusterIndex(ClusterX, ClusterY);
+			float& MinZ = CellMinZ[(ClusterY / CellSize) * NumCells.X + ClusterX / CellSize];
+			const bool bHole = ClusterHoleFlags.Num() > 0 && ClusterHoleFlags[ClusterIndex] != 0;
+			MinZ = bHole ? -MAX_flt : (MinZ == -MAX_flt ? MinZ : FMath::Min(MinZ, LandscapeGpuRenderParameter::GetClusterLocalHeight(ClusterHeightRanges[ClusterIndex] & 0xFFFF)));
+		}
+	}
+
+	//The cell corners are the cluster edges, a vertex is under all the cells around it so the grid stays under the terrain
+	TSharedPtr<TArray<FVector>, ESPMode::ThreadSafe> Vertices = MakeShared<TArray<FVector>, ESPMode::ThreadSafe>();
+	Vertices->SetNumUninitialized((NumCells.X + 1) * (NumCells.Y + 1));
+	for (int32 VertexY = 0; VertexY <= NumCells.Y; ++VertexY) {
+		const int32 ClusterY = FMath::Min(VertexY * CellSize, NumClusters.Y);
+		const float Y = LandscapeGpuRenderParameter::GetClusterFirstQuad(ClusterY, ClusterSizePerSection);
+		for (int32 VertexX = 0; VertexX <= NumCells.X; ++VertexX) {
+			const int32 ClusterX = FMath::Min(VertexX * CellSize, NumClusters.X);
+			const float X = LandscapeGpuRenderParameter::GetClusterFirstQuad(ClusterX, ClusterSizePerSection);
+			float Z = MAX_flt;
+			for (int32 CellY = FMath::Max(VertexY - 1, 0); CellY <= FMath::Min(VertexY, NumCells.Y - 1); ++CellY) {
+				for (int32 CellX = FMath::Max(VertexX - 1, 0); CellX <= FMath::Min(VertexX, NumCells.X - 1); ++CellX) {
+					const float MinZ = CellMinZ[CellY * NumCells.X + CellX];
+					Z = MinZ != -MAX_flt ? FMath::Min(Z, MinZ) : Z;
+				}
+			}
+			(*Vertices)[VertexY * (NumCells.X + 1) + VertexX] = FVector(X, Y, Z != MAX_flt ? Z : 0.f); //Not referenced if all the cells around are holes
+		}
+	}
+
+	//Same winding as FLandscapeSharedBuffers::CreateOccluderIndexBuffer
+	TSharedPtr<TArray<uint16>, ESPMode::ThreadSafe> Indices = MakeShared<TArray<uint16>, ESPMode::ThreadSafe>();
+	Indices->Reserve(NumCells.X * NumCells.Y * 6);
+	const uint16 NumLineVtx = NumCells.X + 1;
+	for (int32 CellY = 0; CellY < NumCells.Y; ++CellY) {
+		for (int32 CellX = 0; CellX < NumCells.X; ++CellX) {
+			if (CellMinZ[CellY * NumCells.X + CellX] == -MAX_flt) {
+				continue;
+			}
+			const uint16 QuadOffset = CellY * NumLineVtx + CellX;
+			Indices->Append({ QuadOffset, uint16(QuadOffset + NumLineVtx), uint16(QuadOffset + NumLineVtx + 1), QuadOffset, uint16(QuadOffset + NumLineVtx + 1), uint16(QuadOffset + 1) });
+		}
+	}
+
+	if (Indices->Num() > 0) {
+		OccluderVertices = MoveTemp(Vertices);
+		OccluderIndices = MoveTemp(Indices);
+	}
 }
 
-void FLandscapeGpuRenderProxyComponent_RenderThread::UpdateAllGPUBuffer() {
-	if (bLandscapeDirty && NumRegisterComponent != 0) {
+bool FLandscapeGpuRenderProxyComponent_RenderThread::UpdateAllGPUBuffer() {
+	//Waits for InitClusterData, the cluster bounds are built on the worker threads
+	if (bLandscapeDirty && NumRegisterComponent != 0 && NumInputClusters != 0) {
 		check(IsInRenderingThread());
 		check(LandscapeComponentMin.X == 0 && LandscapeComponentMin.Y == 0);
 		check(NumRegisterComponent == LandscapeComponentSize.X * LandscapeComponentSize.Y);
@@ -94,57 +309,67 @@ void FLandscapeGpuRenderProxyComponent_RenderThread::UpdateAllGPUBuffer() {
 		ClusterSizeY = ClusterSizePerSection * NumSections * LandscapeComponentSize.Y;
 
 		check(ClusterSqureSizePerComponent * NumRegisterComponent < 0x10000); //Make sure 
+		bStitchingIndexBuffer = CVarMobileLandscapeStitchingIndexBuffer.GetValueOnRenderThread() != 0;
+		const uint32 NumDrawBuckets = GetDrawBucketCount();
 		
-		//Release Resources
+		//Release Resources, the input buffers are kept if their CPU data is already released
+		const bool bUploadClusterInputs = ClusterHeightRanges.Num() != 0;
 		LandscapeClusterLODData_GPU.Release();
-		ComponentOriginAndRadius_GPU.Release();
-		ClusterInputData_GPU.Release();
+		if (bUploadClusterInputs) {
+			ComponentOriginAndRadius_GPU.Release();
+			ClusterInputData_GPU.Release();
+			bClusterInputReadbackPending = false;
+			ReadbackClusterHeightRanges.Empty();
+		}
 		ClusterOutputData_GPU.Release();
 		ClusterLodCountUAV_GPU.Release();
 		OrderClusterOutBufferUAV_GPU.Release();
 		IndirectDrawCommandBuffer_GPU.Release();
+		DrawBucketStart_GPU.Release();
+		bLodHistogramReadbackPending = false; //The pending copy has the old bucket layout
+		bClusterOutputHistoryValid = false;
+		VirtualTextureClusterOutputData_GPU.Release();
+		VirtualTextureClusterLodCount_GPU.Release();
+		VirtualTextureOrderClusterOutBuffer_GPU.Release();
+		VirtualTextureIndirectDrawCommandBuffer_GPU.Release();
+		VirtualTextureDrawBucketStart_GPU.Release();
 		
 		//IndirectDrawBuffer
-		TArray<FLandscapeClusterInputData_CPU> ClusterInputData_CPU;
-		ClusterInputData_CPU.AddZeroed(ClusterSqureSizePerComponent * NumRegisterComponent);
-		for (int32 ComponentIndexY = 0; ComponentIndexY < LandscapeComponentSize.Y; ++ComponentIndexY) {
-			for (int32 ComponentIndexX = 0; ComponentIndexX < LandscapeComponentSize.X; ++ComponentIndexX) {
-				for (uint32 LocalClusterIndexY = 0; LocalClusterIndexY < ClusterSizePerComponent; ++LocalClusterIndexY) {
-					for (uint32 LocalClusterIndexX = 0; LocalClusterIndexX < ClusterSizePerComponent; ++LocalClusterIndexX) {
-						FIntPoint GlobalClusterIndex = FIntPoint(LocalClusterIndexX + ComponentIndexX * ClusterSizePerComponent, LocalClusterIndexY + ComponentIndexY * ClusterSizePerComponent);
-						uint32 ClusterIndex = GetLinearIndexByClusterIndex(GlobalClusterIndex);
-						ClusterInputData_CPU[ClusterIndex].BoundCenter = WorldClusterBounds[ClusterIndex].Origin;
-						ClusterInputData_CPU[ClusterIndex].Pad_0 = 0.f;
-						ClusterInputData_CPU[ClusterIndex].BoundExtent = WorldClusterBounds[ClusterIndex].BoxExtent;
-						ClusterInputData_CPU[ClusterIndex].Pad_1 = 0.f;
-					}
-				}
-			}
-		}
-
 		TArray<FDrawIndirectCommandArgs_CPU> IndirectDrawCommandBuffer_CPU;
-		IndirectDrawCommandBuffer_CPU.AddZeroed(LandscapeGpuRenderParameter::ClusterLodCount);
+		//The unified draw is Lod0 of the solid buckets, so the loop fills its IndexCount and FirstIndex too
+		IndirectDrawCommandBuffer_CPU.AddZeroed(GetIndirectDrawCount());
 		for (int32 DrawElementIndex = 0; DrawElementIndex < IndirectDrawCommandBuffer_CPU.Num(); ++DrawElementIndex) {
-			int32 LodClusterQuadSize = LandscapeGpuRenderParameter::ClusterQuadSize >> DrawElementIndex;
 			auto& DrawCommandBuffer = IndirectDrawCommandBuffer_CPU[DrawElementIndex];
-			DrawCommandBuffer.IndexCount = LodClusterQuadSize * LodClusterQuadSize * 2 * 3;
+			DrawCommandBuffer.IndexCount = LandscapeGpuRenderParameter::GetLodIndexCount(LandscapeGpuRenderParameter::GetDrawBucketLod(DrawElementIndex, bStitchingIndexBuffer));
 			DrawCommandBuffer.InstanceCount = 0;
-			DrawCommandBuffer.FirstIndex = 0;
+			DrawCommandBuffer.FirstIndex = LandscapeGpuRenderParameter::GetDrawBucketFirstIndex(DrawElementIndex, bStitchingIndexBuffer);
 			DrawCommandBuffer.VertexOffset = 0;
 			DrawCommandBuffer.FirstInstance = 0;
 		}
 
-		//ComponentData
-		ComponentOriginAndRadius_GPU.Initialize(sizeof(FVector4), ComponentsOriginAndRadius.Num(), PF_A32B32G32R32F, BUF_Static);
-		void* ComponentDataPtr = RHILockVertexBuffer(ComponentOriginAndRadius_GPU.Buffer, 0, ComponentOriginAndRadius_GPU.NumBytes, RLM_WriteOnly);
-		FMemory::Memcpy(ComponentDataPtr, ComponentsOriginAndRadius.GetData(), ComponentOriginAndRadius_GPU.NumBytes);
-		RHIUnlockVertexBuffer(ComponentOriginAndRadius_GPU.Buffer);
-
-		//InputData
-		ClusterInputData_GPU.Initialize(sizeof(FLandscapeClusterInputData_CPU), ClusterInputData_CPU.Num(), BUF_Static);
-		void* MappingAndBoundData = RHILockStructuredBuffer(ClusterInputData_GPU.Buffer, 0, ClusterInputData_GPU.NumBytes, RLM_WriteOnly);
-		FMemory::Memcpy(MappingAndBoundData, ClusterInputData_CPU.GetData(), ClusterInputData_GPU.NumBytes);
-		RHIUnlockStructuredBuffer(ClusterInputData_GPU.Buffer);
+		if (bUploadClusterInputs) {
+			//ComponentData
+			ComponentOriginAndRadius_GPU.Initialize(sizeof(FVector4), ComponentsOriginAndRadius.Num(), PF_A32B32G32R32F, BUF_Static);
+			void* ComponentDataPtr = RHILockVertexBuffer(ComponentOriginAndRadius_GPU.Buffer, 0, ComponentOriginAndRadius_GPU.NumBytes, RLM_WriteOnly);
+			FMemory::Memcpy(ComponentDataPtr, ComponentsOriginAndRadius.GetData(), ComponentOriginAndRadius_GPU.NumBytes);
+			RHIUnlockVertexBuffer(ComponentOriginAndRadius_GPU.Buffer);
+
+			//InputData, the ranges and the hole flags are copied as they are saved, the shader rebuilds the bounds
+			ClusterInputData_GPU.Initialize(sizeof(uint32), NumInputClusters + FMath::DivideAndRoundUp(NumInputClusters, 4u), PF_R32_UINT, BUF_Static);
+			uint8* ClusterInputData = static_cast<uint8*>(RHILockVertexBuffer(ClusterInputData_GPU.Buffer, 0, ClusterInputData_GPU.NumBytes, RLM_WriteOnly));
+			FMemory::Memcpy(ClusterInputData, ClusterHeightRanges.GetData(), NumInputClusters * sizeof(uint32));
+			uint8* HoleFlagsData = ClusterInputData + NumInputClusters * sizeof(uint32);
+			FMemory::Memcpy(HoleFlagsData, ClusterHoleFlags.GetData(), ClusterHoleFlags.Num());
+			FMemory::Memzero(HoleFlagsData + ClusterHoleFlags.Num(), ClusterInputData_GPU.NumBytes - NumInputClusters * sizeof(uint32) - ClusterHoleFlags.Num());
+			RHIUnlockVertexBuffer(ClusterInputData_GPU.Buffer);
+
+#if !WITH_EDITOR
+			//Nothing reads them once uploaded, the bounds debug draw reads ClusterInputData_GPU back
+			ClusterHeightRanges.Empty();
+			ClusterHoleFlags.Empty();
+			ComponentsOriginAndRadius.Empty();
+#endif
+		}
 
 		//LodDataBuffer
 		LandscapeClusterLODData_GPU.Initialize(sizeof(FLandscapeClusterLODData_CPU), ClusterSqureSizePerComponent * NumRegisterComponent, PF_R32_UINT, BUF_Static);
@@ -153,8 +378,11 @@ void FLandscapeGpuRenderProxyComponent_RenderThread::UpdateAllGPUBuffer() {
 		check(ClusterSqureSizePerComponent * NumRegisterComponent < 65536);
 		ClusterOutputData_GPU.Initialize(sizeof(uint32), ClusterSqureSizePerComponent * NumRegisterComponent * 2, PF_R32_UINT, BUF_Static);
 
-		//LodCountData
-		ClusterLodCountUAV_GPU.Initialize(sizeof(uint32), LandscapeGpuRenderParameter::ClusterLodCount, PF_R32_UINT, BUF_Static);
+		//LodCountData, count per draw bucket
+		ClusterLodCountUAV_GPU.Initialize(sizeof(uint32), NumDrawBuckets, PF_R32_UINT, BUF_Static);
+		if (bStitchingIndexBuffer) {
+			DrawBucketStart_GPU.Initialize(sizeof(uint32), NumDrawBuckets, PF_R32_UINT, BUF_Static);
+		}
 
 		//OrderOutputData
 		OrderClusterOutBufferUAV_GPU.Initialize(sizeof(FLandscapeClusterPackData_CPU), ClusterSqureSizePerComponent * NumRegisterComponent, PF_R32_UINT, BUF_Static);
@@ -167,10 +395,128 @@ void FLandscapeGpuRenderProxyComponent_RenderThread::UpdateAllGPUBuffer() {
 
 		//UserData
 		LandscapeGpuRenderUserData.LandscapeGpuRenderOutputBufferSRV = OrderClusterOutBufferUAV_GPU.SRV;
-		LandscapeGpuRenderUserData.LandscapeGpuRenderFirstIndexSRV = ClusterLodCountUAV_GPU.SRV;
+		LandscapeGpuRenderUserData.LandscapeGpuRenderFirstIndexSRV = bStitchingIndexBuffer ? DrawBucketStart_GPU.SRV : ClusterLodCountUAV_GPU.SRV;
+
+		//Virtual texture pages, written by the page culling instead of the main view one
+		if (bVirtualTexture) {
+			VirtualTextureClusterOutputData_GPU.Initialize(sizeof(uint32), ClusterSqureSizePerComponent * NumRegisterComponent * 2, PF_R32_UINT, BUF_Static);
+			VirtualTextureClusterLodCount_GPU.Initialize(sizeof(uint32), NumDrawBuckets, PF_R32_UINT, BUF_Static);
+			if (bStitchingIndexBuffer) {
+				VirtualTextureDrawBucketStart_GPU.Initialize(sizeof(uint32), NumDrawBuckets, PF_R32_UINT, BUF_Static);
+			}
+			VirtualTextureOrderClusterOutBuffer_GPU.Initialize(sizeof(FLandscapeClusterPackData_CPU), ClusterSqureSizePerComponent * NumRegisterComponent, PF_R32_UINT, BUF_Static);
+			VirtualTextureIndirectDrawCommandBuffer_GPU.Initialize(sizeof(uint32), IndirectDrawCommandBuffer_CPU.Num() * SLGPUDrivenParameter::IndirectBufferElementSize, PF_R32_UINT, BUF_DrawIndirect | BUF_Static);
+			void* VirtualTextureIndirectBufferData = RHILockVertexBuffer(VirtualTextureIndirectDrawCommandBuffer_GPU.Buffer, 0, VirtualTextureIndirectDrawCommandBuffer_GPU.NumBytes, RLM_WriteOnly);
+			FMemory::Memcpy(VirtualTextureIndirectBufferData, IndirectDrawCommandBuffer_CPU.GetData(), VirtualTextureIndirectDrawCommandBuffer_GPU.NumBytes);
+			RHIUnlockVertexBuffer(VirtualTextureIndirectDrawCommandBuffer_GPU.Buffer);
+
+			VirtualTextureUserData.LandscapeGpuRenderOutputBufferSRV = VirtualTextureOrderClusterOutBuffer_GPU.SRV;
+			VirtualTextureUserData.LandscapeGpuRenderFirstIndexSRV = bStitchingIndexBuffer ? VirtualTextureDrawBucketStart_GPU.SRV : VirtualTextureClusterLodCount_GPU.SRV;
+		}
 
+		UpdateCullingUniformBuffer();
 		bLandscapeDirty = false;
+		if (OnAllocatedSizeChanged) {
+			OnAllocatedSizeChanged();
+		}
+		return true;
 	}
+	return false;
+}
+
+void FLandscapeGpuRenderProxyComponent_RenderThread::ResolveLodHistogram() {
+	check(IsInRenderingThread());
+	if (!bLodHistogramReadbackPending || !ClusterLodCountReadback->IsReady()) {
+		return;
+	}
+	bLodHistogramReadbackPending = false;
+
+	//Sum the draw buckets of every Lod, the finest Lod with clusters is what the heightmap must keep resident
+	const uint32 NumDrawBuckets = GetDrawBucketCount();
+	const uint32* LodCountData = static_cast<const uint32*>(ClusterLodCountReadback->Lock(NumDrawBuckets * sizeof(uint32)));
+	uint32 NewFinestDrawnLod = LandscapeGpuRenderParameter::ClusterLodCount;
+	for (uint32 DrawBucket = 0; DrawBucket < NumDrawBuckets; ++DrawBucket) {
+		if (LodCountData[DrawBucket] != 0) {
+			NewFinestDrawnLod = FMath::Min(NewFinestDrawnLod, LandscapeGpuRenderParameter::GetDrawBucketLod(DrawBucket, bStitchingIndexBuffer));
+		}
+	}
+	ClusterLodCountReadback->Unlock();
+
+	//Nothing visible, keep the resident mips for when the landscape comes back into view
+	if (NewFinestDrawnLod < LandscapeGpuRenderParameter::ClusterLodCount && NewFinestDrawnLod != FinestDrawnLod) {
+		FinestDrawnLod = NewFinestDrawnLod;
+		if (OnFinestDrawnLodChanged) {
+			OnFinestDrawnLodChanged(FinestDrawnLod);
+		}
+	}
+}
+
+void FLandscapeGpuRenderProxyComponent_RenderThread::EnqueueLodHistogramReadback(FRHICommandList& RHICmdList) {
+	if (bLodHistogramReadbackPending) {
+		return; //Just one copy in flight
+	}
+	if (ClusterLodCountReadback == nullptr) {
+		ClusterLodCountReadback = new FRHIGPUBufferReadback(TEXT("LandscapeClusterLodCountReadback"));
+	}
+
+	RHICmdList.Transition(FRHITransitionInfo(ClusterLodCountUAV_GPU.UAV, ERHIAccess::SRVCompute, ERHIAccess::CopySrc));
+	ClusterLodCountReadback->EnqueueCopy(RHICmdList, ClusterLodCountUAV_GPU.Buffer, GetDrawBucketCount() * sizeof(uint32));
+	RHICmdList.Transition(FRHITransitionInfo(ClusterLodCountUAV_GPU.UAV, ERHIAccess::CopySrc, ERHIAccess::SRVCompute));
+	bLodHistogramReadbackPending = true;
+}
+
+const TArray<uint32>& FLandscapeGpuRenderProxyComponent_RenderThread::GetDebugClusterHeightRanges() {
+	if (ClusterHeightRanges.Num() != 0) {
+		return ClusterHeightRanges;
+	}
+	bClusterInputReadbackRequested = ReadbackClusterHeightRanges.Num() == 0;
+	return ReadbackClusterHeightRanges;
+}
+
+void FLandscapeGpuRenderProxyComponent_RenderThread::ResolveClusterInputReadback() {
+	check(IsInRenderingThread());
+	if (!bClusterInputReadbackPending || !ClusterInputReadback->IsReady()) {
+		return;
+	}
+	bClusterInputReadbackPending = false;
+
+	const uint32* ClusterInputData = static_cast<const uint32*>(ClusterInputReadback->Lock(NumInputClusters * sizeof(uint32)));
+	ReadbackClusterHeightRanges.SetNumUninitialized(NumInputClusters);
+	FMemory::Memcpy(ReadbackClusterHeightRanges.GetData(), ClusterInputData, NumInputClusters * sizeof(uint32));
+	ClusterInputReadback->Unlock();
+	if (OnAllocatedSizeChanged) {
+		OnAllocatedSizeChanged();
+	}
+}
+
+void FLandscapeGpuRenderProxyComponent_RenderThread::EnqueueClusterInputReadback(FRHICommandList& RHICmdList) {
+	if (!bClusterInputReadbackRequested || bClusterInputReadbackPending || !ClusterInputData_GPU.Buffer) {
+		return;
+	}
+	bClusterInputReadbackRequested = false;
+	if (ClusterInputReadback == nullptr) {
+		ClusterInputReadback = new FRHIGPUBufferReadback(TEXT("LandscapeClusterInputReadback"));
+	}
+
+	RHICmdList.Transition(FRHITransitionInfo(ClusterInputData_GPU.Buffer, ERHIAccess::SRVCompute, ERHIAccess::CopySrc));
+	ClusterInputReadback->EnqueueCopy(RHICmdList, ClusterInputData_GPU.Buffer, NumInputClusters * sizeof(uint32)); //Just the ranges
+	RHICmdList.Transition(FRHITransitionInfo(ClusterInputData_GPU.Buffer, ERHIAccess::CopySrc, ERHIAccess::SRVCompute));
+	bClusterInputReadbackPending = true;
+}
+
+SIZE_T FLandscapeGpuRenderProxyComponent_RenderThread::GetCPUAllocatedSize() const {
+	SIZE_T AllocatedSize = ClusterHeightRanges.GetAllocatedSize() + ClusterHoleFlags.GetAllocatedSize() + ComponentsOriginAndRadius.GetAllocatedSize() + ReadbackClusterHeightRanges.GetAllocatedSize();
+	if (OccluderVertices.IsValid()) {
+		AllocatedSize += OccluderVertices->GetAllocatedSize() + OccluderIndices->GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+SIZE_T FLandscapeGpuRenderProxyComponent_RenderThread::GetGPUAllocatedSize() const {
+	return LandscapeClusterLODData_GPU.NumBytes + ComponentOriginAndRadius_GPU.NumBytes + ClusterInputData_GPU.NumBytes + ClusterOutputData_GPU.NumBytes
+		+ ClusterLodCountUAV_GPU.NumBytes + OrderClusterOutBufferUAV_GPU.NumBytes + IndirectDrawCommandBuffer_GPU.NumBytes + DrawBucketStart_GPU.NumBytes
+		+ VirtualTextureClusterOutputData_GPU.NumBytes + VirtualTextureClusterLodCount_GPU.NumBytes + VirtualTextureOrderClusterOutBuffer_GPU.NumBytes
+		+ VirtualTextureIndirectDrawCommandBuffer_GPU.NumBytes + VirtualTextureDrawBucketStart_GPU.NumBytes;
 }
 
 void FLandscapeGpuRenderProxyComponent_RenderThread::RegisterComponentData(const FLandscapeSubmitData& SubmitToRenderThreadComponentData) {
@@ -197,7 +543,6 @@ void FLandscapeGpuRenderProxyComponent_RenderThread::RegisterComponentData(const
 		LandscapeComponentSize = FIntPoint(1, 1);
 	}
 	NumRegisterComponent += 1;
-	MarkDirty();
 }
 
 void FLandscapeGpuRenderProxyComponent_RenderThread::UnRegisterComponentData() {
@@ -209,8 +554,351 @@ void FLandscapeGpuRenderProxyComponent_RenderThread::MarkDirty() {
 	bLandscapeDirty = true;
 }
 
+void FLandscapeGpuRenderProxyComponent_RenderThread::SetLocalToWorld(const FMatrix& InLocalToWorld) {
+	LocalToWorld = InLocalToWorld;
+	WorldToLocal = InLocalToWorld.Inverse();
+	if (IndirectDrawCommandBuffer_GPU.Buffer) {
+		UpdateCullingUniformBuffer(); //Else built with the GPU buffers
+	}
+}
+
+void FLandscapeGpuRenderProxyComponent_RenderThread::UpdateCullingUniformBuffer() {
+	check(IsInRenderingThread());
+	const uint32 ClusterSizePerComponent = ClusterSizePerSection * NumSections;
+	FLandscapeGpuCullingLandscapeParameters Parameters;
+	Parameters.LocalToWorld = LocalToWorld;
+	Parameters.LodSettings = LodSettingParameters;
+	Parameters.LodParameters = FVector4(LocalToWorld.GetMaximumAxisScale(), ClusterSizePerComponent * ClusterSizePerComponent, NumRegisterComponent, 0.f);
+	Parameters.LandscapeParameters = FUintVector4(LandscapeComponentSize.X, LandscapeComponentSize.Y, ClusterSizePerComponent, 0);
+	Parameters.ClusterInputParameters = GetClusterInputParameters();
+	CullingUniformBuffer = TUniformBufferRef<FLandscapeGpuCullingLandscapeParameters>::CreateUniformBufferImmediate(Parameters, UniformBuffer_MultiFrame);
+}
+
+//------------------------------------------------VirtualHeightmap------------------------------------------------//
+FLandscapeVirtualHeightmap_RenderThread::FLandscapeVirtualHeightmap_RenderThread(const FByteBulkData* InPageBulkData, uint32 InSectionVerts, const FIntPoint& InNumSectionPages)
+	: PageBulkData(InPageBulkData)
+	, SectionVerts(InSectionVerts)
+	, NumSectionPages(InNumSectionPages)
+	, NumPages(LandscapeGpuRenderParameter::GetVirtualHeightmapLevelFirstPage(InNumSectionPages, LandscapeGpuRenderParameter::VirtualHeightmapLevelCount))
+	, SlotsPerRow(FMath::Clamp<uint32>(CVarMobileLandscapeVirtualHeightmapPoolSize.GetValueOnRenderThread(), 1, GMaxTextureDimensions / InSectionVerts))
+	, RequestStamp(1)
+	, PageRequestReadbackStamp(0)
+	, bPageTableDirty(false)
+	, PageRequestReadback(nullptr)
+{
+	check(IsInRenderingThread());
+	check(PageBulkData->GetBulkDataSize() == NumPages * LandscapeGpuRenderParameter::GetVirtualHeightmapPageDataSize(SectionVerts));
+
+	const uint32 NumSlots = SlotsPerRow * SlotsPerRow;
+	PageTable_CPU.Init(LandscapeGpuRenderParameter::VirtualHeightmapInvalidSlot, NumPages);
+	SlotToPage.Init(INDEX_NONE, NumSlots);
+	SlotLastRequestStamp.Init(0, NumSlots);
+
+	//Same format as the heightmap, the page data is FColor
+	FRHIResourceCreateInfo CreateInfo(TEXT("LandscapeVirtualHeightmapAtlas"));
+	PhysicalAtlas_GPU = RHICreateTexture2D(GetAtlasSize(), GetAtlasSize(), PF_B8G8R8A8, 1, 1, TexCreate_ShaderResource, ERHIAccess::SRVMask, CreateInfo);
+
+	PageTable_GPU.Initialize(sizeof(uint32), NumPages, PF_R32_UINT, BUF_Dynamic);
+	void* PageTableData = RHILockVertexBuffer(PageTable_GPU.Buffer, 0, PageTable_GPU.NumBytes, RLM_WriteOnly);
+	FMemory::Memcpy(PageTableData, PageTable_CPU.GetData(), PageTable_GPU.NumBytes);
+	RHIUnlockVertexBuffer(PageTable_GPU.Buffer);
+
+	//0 is never a RequestStamp
+	PageRequest_GPU.Initialize(sizeof(uint32), NumPages, PF_R32_UINT, BUF_Static);
+	void* PageRequestData = RHILockVertexBuffer(PageRequest_GPU.Buffer, 0, PageRequest_GPU.NumBytes, RLM_WriteOnly);
+	FMemory::Memzero(PageRequestData, PageRequest_GPU.NumBytes);
+	RHIUnlockVertexBuffer(PageRequest_GPU.Buffer);
+}
+
+FLandscapeVirtualHeightmap_RenderThread::~FLandscapeVirtualHeightmap_RenderThread() {
+	//The destination memory of the reads in flight is ours
+	for (auto& PendingPagePair : PendingPages) {
+		FLandscapeVirtualHeightmapPendingPage& PendingPage = PendingPagePair.Value;
+		PendingPage.IORequest->Cancel();
+		PendingPage.IORequest->WaitCompletion();
+		delete PendingPage.IORequest;
+		FMemory::Free(PendingPage.PageData);
+	}
+	PendingPages.Empty();
+
+	PhysicalAtlas_GPU.SafeRelease();
+	PageTable_GPU.Release();
+	PageRequest_GPU.Release();
+	delete PageRequestReadback;
+	PageRequestReadback = nullptr;
+}
+
+void FLandscapeVirtualHeightmap_RenderThread::UpdatePages(FRHICommandListImmediate& RHICmdList) {
+	check(IsInRenderingThread());
+
+	//Upload the pages streamed in
+	for (auto It = PendingPages.CreateIterator(); It; ++It) {
+		FLandscapeVirtualHeightmapPendingPage& PendingPage = It.Value();
+		if (!PendingPage.IORequest->PollCompletion()) {
+			continue;
+		}
+		if (PendingPage.IORequest->GetReadResults() != nullptr) {
+			UploadPage(RHICmdList, It.Key(), PendingPage.Slot, PendingPage.PageData);
+		}
+		else {
+			SlotToPage[PendingPage.Slot] = INDEX_NONE; //Read failed, the page is requested again
+		}
+		delete PendingPage.IORequest;
+		FMemory::Free(PendingPage.PageData);
+		It.RemoveCurrent();
+	}
+
+	//Resolve the requests
+	if (PageRequestReadbackStamp != 0 && PageRequestReadback->IsReady()) {
+		const uint32* PageRequestData = static_cast<const uint32*>(PageRequestReadback->Lock(NumPages * sizeof(uint32)));
+
+		//Touch the resident pages first, so none of them is evicted for another page of the same request
+		for (uint32 PageIndex = 0; PageIndex < NumPages; ++PageIndex) {
+			const uint32 ResidentSlot = PageTable_CPU[PageIndex];
+			if (PageRequestData[PageIndex] == PageRequestReadbackStamp && ResidentSlot != LandscapeGpuRenderParameter::VirtualHeightmapInvalidSlot) {
+				SlotLastRequestStamp[ResidentSlot] = PageRequestReadbackStamp;
+			}
+		}
+
+		//Coarse levels first, they are the fallback of the finer ones
+		for (int32 PageIndex = NumPages - 1; PageIndex >= 0 && PendingPages.Num() < LandscapeGpuRenderParameter::VirtualHeightmapMaxPendingPages; --PageIndex) {
+			if (PageRequestData[PageIndex] != PageRequestReadbackStamp
+				|| PageTable_CPU[PageIndex] != LandscapeGpuRenderParameter::VirtualHeightmapInvalidSlot
+				|| PendingPages.Contains(PageIndex)) {
+				continue;
+			}
+			const int32 Slot = AllocateSlot(PageRequestReadbackStamp);
+			if (Slot == INDEX_NONE) {
+				break; //Every slot is requested by the view, the pool is too small
+			}
+			LoadPage(RHICmdList, PageIndex, Slot);
+		}
+
+		PageRequestReadback->Unlock();
+		PageRequestReadbackStamp = 0;
+	}
+
+	if (bPageTableDirty) {
+		void* PageTableData = RHILockVertexBuffer(PageTable_GPU.Buffer, 0, PageTable_GPU.NumBytes, RLM_WriteOnly);
+		FMemory::Memcpy(PageTableData, PageTable_CPU.GetData(), PageTable_GPU.NumBytes);
+		RHIUnlockVertexBuffer(PageTable_GPU.Buffer);
+		bPageTableDirty = false;
+	}
+
+	//Stamp of this frame's culling
+	RequestStamp = RequestStamp == MAX_uint32 ? 1 : RequestStamp + 1;
+}
+
+int32 FLandscapeVirtualHeightmap_RenderThread::AllocateSlot(uint32 RequestReadbackStamp) {
+	int32 LeastRecentSlot = INDEX_NONE;
+	for (int32 Slot = 0; Slot < SlotToPage.Num(); ++Slot) {
+		const int32 SlotPage = SlotToPage[Slot];
+		if (SlotPage == INDEX_NONE) {
+			LeastRecentSlot = Slot;
+			break;
+		}
+		const bool bEvictable = SlotLastRequestStamp[Slot] != RequestReadbackStamp && PageTable_CPU[SlotPage] == static_cast<uint32>(Slot); //Not requested, not loading
+		if (bEvictable && (LeastRecentSlot == INDEX_NONE || SlotLastRequestStamp[Slot] < SlotLastRequestStamp[LeastRecentSlot])) {
+			LeastRecentSlot = Slot;
+		}
+	}
+
+	if (LeastRecentSlot != INDEX_NONE) {
+		const int32 EvictedPage = SlotToPage[LeastRecentSlot];
+		if (EvictedPage != INDEX_NONE) {
+			PageTable_CPU[EvictedPage] = LandscapeGpuRenderParameter::VirtualHeightmapInvalidSlot;
+			bPageTableDirty = true;
+		}
+		SlotLastRequestStamp[LeastRecentSlot] = RequestReadbackStamp;
+	}
+	return LeastRecentSlot;
+}
+
+void FLandscapeVirtualHeightmap_RenderThread::LoadPage(FRHICommandListImmediate& RHICmdList, uint32 PageIndex, uint32 Slot) {
+	const int64 PageDataSize = LandscapeGpuRenderParameter::GetVirtualHeightmapPageDataSize(SectionVerts);
+	SlotToPage[Slot] = PageIndex;
+
+	//Editor, the pages are not saved yet
+	if (PageBulkData->IsBulkDataLoaded()) {
+		const uint8* BulkData = static_cast<const uint8*>(PageBulkData->LockReadOnly());
+		UploadPage(RHICmdList, PageIndex, Slot, BulkData + PageIndex * PageDataSize);
+		PageBulkData->Unlock();
+		return;
+	}
+
+	FLandscapeVirtualHeightmapPendingPage PendingPage;
+	PendingPage.PageData = static_cast<uint8*>(FMemory::Malloc(PageDataSize));
+	PendingPage.IORequest = PageBulkData->CreateStreamingRequest(PageIndex * PageDataSize, PageDataSize, AIOP_Low, nullptr, PendingPage.PageData);
+	PendingPage.Slot = Slot;
+	PendingPages.Emplace(PageIndex, PendingPage);
+}
+
+void FLandscapeVirtualHeightmap_RenderThread::UploadPage(FRHICommandListImmediate& RHICmdList, uint32 PageIndex, uint32 Slot, const uint8* PageData) {
+	const FUpdateTextureRegion2D PageRegion((Slot % SlotsPerRow) * SectionVerts, (Slot / SlotsPerRow) * SectionVerts, 0, 0, SectionVerts, SectionVerts);
+	RHICmdList.UpdateTexture2D(PhysicalAtlas_GPU, 0, PageRegion, SectionVerts * sizeof(uint32), PageData);
+	PageTable_CPU[PageIndex] = Slot;
+	bPageTableDirty = true;
+}
+
+void FLandscapeVirtualHeightmap_RenderThread::EnqueuePageRequestReadback(FRHICommandList& RHICmdList) {
+	RHICmdList.Transition(FRHITransitionInfo(PageRequest_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute)); //Written by the culling CS
+	if (PageRequestReadbackStamp != 0) {
+		return; //Just one copy in flight
+	}
+	if (PageRequestReadback == nullptr) {
+		PageRequestReadback = new FRHIGPUBufferReadback(TEXT("LandscapeVirtualHeightmapPageRequestReadback"));
+	}
+
+	RHICmdList.Transition(FRHITransitionInfo(PageRequest_GPU.UAV, ERHIAccess::SRVCompute, ERHIAccess::CopySrc));
+	PageRequestReadback->EnqueueCopy(RHICmdList, PageRequest_GPU.Buffer, NumPages * sizeof(uint32));
+	RHICmdList.Transition(FRHITransitionInfo(PageRequest_GPU.UAV, ERHIAccess::CopySrc, ERHIAccess::SRVCompute));
+	PageRequestReadbackStamp = RequestStamp;
+}
+
+//------------------------------------------------HeightmapArray------------------------------------------------//
+FLandscapeHeightmapArray_RenderThread::FLandscapeHeightmapArray_RenderThread(const TArray<FTextureReferenceRHIRef>& InHeightmaps, const TArray<FIntPoint>& InHeightmapSizes, const TArray<uint32>& InSectionHeightmaps, const TArray<FIntPoint>& InSectionTexels)
+	: ArraySize(0)
+	, NumArrayMips(0)
+	, Heightmaps(InHeightmaps)
+	, SectionHeightmaps(InSectionHeightmaps)
+	, SectionTexels(InSectionTexels)
+	, bSectionTableDirty(true)
+{
+	check(IsInRenderingThread());
+	check(Heightmaps.Num() == InHeightmapSizes.Num() && static_cast<uint32>(Heightmaps.Num()) <= LandscapeGpuRenderParameter::HeightmapArrayMaxSlices);
+	check(SectionHeightmaps.Num() == SectionTexels.Num());
+
+	//The smaller heightmaps sit at the top left of their slice, the texel of a section is the same in every mip
+	HeightmapNumMips.Reserve(InHeightmapSizes.Num());
+	for (const FIntPoint& HeightmapSize : InHeightmapSizes) {
+		const uint32 HeightmapMaxSize = FMath::Max(HeightmapSize.X, HeightmapSize.Y);
+		check(HeightmapMaxSize <= LandscapeGpuRenderParameter::HeightmapArrayMaxTexel);
+		ArraySize = FMath::Max(ArraySize, HeightmapMaxSize);
+		HeightmapNumMips.Emplace(FMath::FloorLog2(HeightmapMaxSize) + 1);
+	}
+	NumArrayMips = FMath::Min<uint32>(FMath::FloorLog2(ArraySize) + 1, LandscapeGpuRenderParameter::ClusterLodCount);
+
+	CopiedTextures.SetNum(Heightmaps.Num());
+	SliceFirstMips.Init(NumArrayMips - 1, Heightmaps.Num());
+
+	FRHIResourceCreateInfo CreateInfo(TEXT("LandscapeHeightmapArray"));
+	HeightmapArray_GPU = RHICreateTexture2DArray(ArraySize, ArraySize, Heightmaps.Num(), PF_B8G8R8A8, NumArrayMips, 1, TexCreate_ShaderResource, ERHIAccess::SRVMask, CreateInfo);
+
+	SectionTable_GPU.Initialize(sizeof(uint32), SectionHeightmaps.Num(), PF_R32_UINT, BUF_Dynamic);
+}
+
+FLandscapeHeightmapArray_RenderThread::~FLandscapeHeightmapArray_RenderThread() {
+	CopiedTextures.Empty();
+	HeightmapArray_GPU.SafeRelease();
+	SectionTable_GPU.Release();
+}
+
+void FLandscapeHeightmapArray_RenderThread::UpdateSlices(FRHICommandListImmediate& RHICmdList) {
+	check(IsInRenderingThread());
+
+	//The streaming reallocates the heightmap when its resident mips change, the reference follows it
+	for (int32 Slice = 0; Slice < Heightmaps.Num(); ++Slice) {
+		FRHITexture* SourceTexture = Heightmaps[Slice]->GetReferencedTexture();
+		if (SourceTexture != nullptr && SourceTexture != CopiedTextures[Slice] && CopySlice(RHICmdList, Slice, SourceTexture)) {
+			CopiedTextures[Slice] = SourceTexture;
+			bSectionTableDirty = true;
+		}
+	}
+
+	if (bSectionTableDirty) {
+		bSectionTableDirty = false;
+		uint32* SectionTableData = static_cast<uint32*>(RHILockVertexBuffer(SectionTable_GPU.Buffer, 0, SectionTable_GPU.NumBytes, RLM_WriteOnly));
+		for (int32 SectionIndex = 0; SectionIndex < SectionHeightmaps.Num(); ++SectionIndex) {
+			const uint32 Slice = SectionHeightmaps[SectionIndex];
+			SectionTableData[SectionIndex] = LandscapeGpuRenderParameter::PackHeightmapArraySection(Slice, SliceFirstMips[Slice], SectionTexels[SectionIndex].X, SectionTexels[SectionIndex].Y);
+		}
+		RHIUnlockVertexBuffer(SectionTable_GPU.Buffer);
+	}
+}
+
+bool FLandscapeHeightmapArray_RenderThread::CopySlice(FRHICommandListImmediate& RHICmdList, uint32 Slice, FRHITexture* SourceTexture) {
+	//The streamed out mips are missing from the top, the source mip0 is the mip FirstMip of the heightmap
+	const uint32 SourceNumMips = SourceTexture->GetNumMips();
+	const uint32 FirstMip = HeightmapNumMips[Slice] > SourceNumMips ? HeightmapNumMips[Slice] - SourceNumMips : 0;
+	if (SourceTexture->GetFormat() != PF_B8G8R8A8 || FirstMip >= NumArrayMips) {
+		return false; //Not streamed in yet
+	}
+
+	const FIntVector SourceSize = SourceTexture->GetSizeXYZ();
+	RHICmdList.Transition({
+		FRHITransitionInfo(SourceTexture, ERHIAccess::SRVMask, ERHIAccess::CopySrc),
+		FRHITransitionInfo(HeightmapArray_GPU, ERHIAccess::SRVMask, ERHIAccess::CopyDest)
+	});
+	for (uint32 MipIndex = FirstMip; MipIndex < NumArrayMips; ++MipIndex) {
+		FRHICopyTextureInfo CopyInfo;
+		CopyInfo.SourceMipIndex = MipIndex - FirstMip;
+		CopyInfo.DestMipIndex = MipIndex;
+		CopyInfo.DestSliceIndex = Slice;
+		CopyInfo.Size = FIntVector(FMath::Max(SourceSize.X >> CopyInfo.SourceMipIndex, 1), FMath::Max(SourceSize.Y >> CopyInfo.SourceMipIndex, 1), 1);
+		RHICmdList.CopyTexture(SourceTexture, HeightmapArray_GPU, CopyInfo);
+	}
+	RHICmdList.Transition({
+		FRHITransitionInfo(SourceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask),
+		FRHITransitionInfo(HeightmapArray_GPU, ERHIAccess::CopyDest, ERHIAccess::SRVMask)
+	});
+
+	SliceFirstMips[Slice] = FirstMip;
+	return true;
+}
+
+//------------------------------------------------Grass------------------------------------------------//
+void FLandscapeGpuGrassInstanceBuffer::InitRHI() {
+	//Bound as vertex streams by the grass vertex factories, written by the grass CS
+	FRHIResourceCreateInfo CreateInfo(TEXT("LandscapeGpuGrassInstanceBuffer"));
+	VertexBufferRHI = RHICreateVertexBuffer(NumBytes, BUF_Static | BUF_UnorderedAccess | BUF_ShaderResource, ERHIAccess::VertexOrIndexBuffer, CreateInfo);
+	UAV = RHICreateUnorderedAccessView(VertexBufferRHI, PF_A32B32G32R32F);
+}
+
+void FLandscapeGpuGrassInstanceBuffer::ReleaseRHI() {
+	UAV.SafeRelease();
+	FVertexBuffer::ReleaseRHI();
+}
+
+FLandscapeGpuGrass_RenderThread::FLandscapeGpuGrass_RenderThread(const TArray<FLandscapeGpuGrassVariety>& InVarieties, const TArray<FLandscapeGpuGrassDraw>& InDraws, const TArray<FTextureReferenceRHIRef>& InWeightmaps, const FIntPoint& InWeightmapSize)
+	: MaxInstancesPerVariety(FMath::Max(CVarMobileLandscapeGpuGrassMaxInstances.GetValueOnRenderThread(), 1))
+	, Varieties(InVarieties)
+	, Draws(InDraws)
+	, Weightmaps(InWeightmaps)
+	, WeightmapSize(InWeightmapSize)
+	, InvLandscapeScale(1.f, 1.f, 1.f)
+	, InstanceBuffer(InVarieties.Num() * MaxInstancesPerVariety * LandscapeGpuRenderParameter::GrassInstanceStride)
+{
+	check(IsInRenderingThread());
+	check(Varieties.Num() > 0 && static_cast<uint32>(Varieties.Num()) <= LandscapeGpuRenderParameter::GrassMaxVarieties);
+	check(Draws.Num() > 0 && static_cast<uint32>(Draws.Num()) <= LandscapeGpuRenderParameter::GrassMaxDraws);
+	check(Weightmaps.Num() > 0);
+
+	InstanceBuffer.InitResource();
+	InstanceCount_GPU.Initialize(sizeof(uint32), LandscapeGpuRenderParameter::GrassMaxVarieties, PF_R32_UINT, BUF_Static);
+	DispatchArgs_GPU.Initialize(sizeof(uint32), 3, PF_R32_UINT, BUF_DrawIndirect | BUF_Static);
+
+	//The grass CS just writes the instance count
+	TArray<FDrawIndirectCommandArgs_CPU> DrawArgs_CPU;
+	DrawArgs_CPU.AddZeroed(Draws.Num());
+	for (int32 DrawIndex = 0; DrawIndex < Draws.Num(); ++DrawIndex) {
+		DrawArgs_CPU[DrawIndex].IndexCount = Draws[DrawIndex].IndexCount;
+		DrawArgs_CPU[DrawIndex].FirstIndex = Draws[DrawIndex].FirstIndex;
+	}
+	DrawArgs_GPU.Initialize(sizeof(uint32), DrawArgs_CPU.Num() * SLGPUDrivenParameter::IndirectBufferElementSize, PF_R32_UINT, BUF_DrawIndirect | BUF_Static);
+	void* DrawArgsData = RHILockVertexBuffer(DrawArgs_GPU.Buffer, 0, DrawArgs_GPU.NumBytes, RLM_WriteOnly);
+	FMemory::Memcpy(DrawArgsData, DrawArgs_CPU.GetData(), DrawArgs_GPU.NumBytes);
+	RHIUnlockVertexBuffer(DrawArgs_GPU.Buffer);
+}
+
+FLandscapeGpuGrass_RenderThread::~FLandscapeGpuGrass_RenderThread() {
+	InstanceBuffer.ReleaseResource();
+	InstanceCount_GPU.Release();
+	DispatchArgs_GPU.Release();
+	DrawArgs_GPU.Release();
+}
+
 //------------------------------------------------SystemRenderThread------------------------------------------------//
-TMap<uint32, FMobileLandscapeGPURenderSystem_RenderThread*> FMobileLandscapeGPURenderSystem_RenderThread::LandscapeGPURenderSystem_RenderThread;
+TMap<uint32, TUniquePtr<FMobileLandscapeGPURenderSystem_RenderThread>> FMobileLandscapeGPURenderSystem_RenderThread::LandscapeGPURenderSystem_RenderThread;
 
 FMobileLandscapeGPURenderSystem_RenderThread::FMobileLandscapeGPURenderSystem_RenderThread(/*uint32 NumComponents*/)
 //: NumComponents(0)
@@ -223,32 +911,35 @@ FMobileLandscapeGPURenderSystem_RenderThread::~FMobileLandscapeGPURenderSystem_R
 	check(NumAllRegisterComponents_RenderThread == 0);
 }
 
-void FMobileLandscapeGPURenderSystem_RenderThread::RegisterGPURenderLandscapeEntity_RenderThread(const FLandscapeSubmitData& SubmitToRenderThreadComponentData) {
+void FMobileLandscapeGPURenderSystem_RenderThread::RegisterGPURenderLandscapeEntities_RenderThread(TArrayView<const FLandscapeSubmitData> SubmitToRenderThreadComponentData) {
 	check(IsInRenderingThread());
+	check(SubmitToRenderThreadComponentData.Num() > 0);
+	const FLandscapeSubmitData& FirstSubmitData = SubmitToRenderThreadComponentData[0];
 
-	FMobileLandscapeGPURenderSystem_RenderThread** FoundSystemPtr = LandscapeGPURenderSystem_RenderThread.Find(SubmitToRenderThreadComponentData.UniqueWorldId);
-	FMobileLandscapeGPURenderSystem_RenderThread* FoundSystem = FoundSystemPtr == nullptr
-		? LandscapeGPURenderSystem_RenderThread.Emplace(SubmitToRenderThreadComponentData.UniqueWorldId, new FMobileLandscapeGPURenderSystem_RenderThread())
-		: *FoundSystemPtr;
+	TUniquePtr<FMobileLandscapeGPURenderSystem_RenderThread>& FoundSystem = LandscapeGPURenderSystem_RenderThread.FindOrAdd(FirstSubmitData.UniqueWorldId);
+	if (!FoundSystem.IsValid()) {
+		FoundSystem = MakeUnique<FMobileLandscapeGPURenderSystem_RenderThread>();
+	}
 
-	FLandscapeGpuRenderProxyComponent_RenderThread* RenderComponent = FoundSystem->LandscapeGpuRenderComponent_RenderThread.Find(SubmitToRenderThreadComponentData.LandscapeKey);
-	if (RenderComponent == nullptr) {
-		FLandscapeGpuRenderProxyComponent_RenderThread& EmplaceComponent = FoundSystem->LandscapeGpuRenderComponent_RenderThread.Emplace(
-			SubmitToRenderThreadComponentData.LandscapeKey, 
-			FLandscapeGpuRenderProxyComponent_RenderThread()
-		);
-		RenderComponent = &EmplaceComponent;
+	//Heap allocated so the scene proxy can hold it across the rehashes of the map
+	TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe>& RenderComponent = FoundSystem->LandscapeGpuRenderComponent_RenderThread.FindOrAdd(FirstSubmitData.LandscapeKey);
+	if (!RenderComponent.IsValid()) {
+		RenderComponent = MakeShared<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe>();
+	}
+	for (const FLandscapeSubmitData& ComponentData : SubmitToRenderThreadComponentData) {
+		check(ComponentData.LandscapeKey == FirstSubmitData.LandscapeKey);
+		RenderComponent->RegisterComponentData(ComponentData);
 	}
-	RenderComponent->RegisterComponentData(SubmitToRenderThreadComponentData);
-	FoundSystem->NumAllRegisterComponents_RenderThread += 1;
+	RenderComponent->MarkDirty(); //The buffers are rebuilt once for the batch
+	FoundSystem->NumAllRegisterComponents_RenderThread += SubmitToRenderThreadComponentData.Num();
 }
 
 void FMobileLandscapeGPURenderSystem_RenderThread::UnRegisterGPURenderLandscapeEntity_RenderThread(const FLandscapeSubmitData& SubmitToRenderThreadComponentData) {
 	check(IsInRenderingThread());
-	FMobileLandscapeGPURenderSystem_RenderThread* FoundSystem = LandscapeGPURenderSystem_RenderThread.FindChecked(SubmitToRenderThreadComponentData.UniqueWorldId);
-	FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponent = FoundSystem->LandscapeGpuRenderComponent_RenderThread.FindChecked(SubmitToRenderThreadComponentData.LandscapeKey);
+	FMobileLandscapeGPURenderSystem_RenderThread* FoundSystem = LandscapeGPURenderSystem_RenderThread.FindChecked(SubmitToRenderThreadComponentData.UniqueWorldId).Get();
+	FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponent = *FoundSystem->LandscapeGpuRenderComponent_RenderThread.FindChecked(SubmitToRenderThreadComponentData.LandscapeKey);
 
-	//Release Component
+	//Release Component, a scene proxy still holding it releases it later
 	RenderComponent.UnRegisterComponentData();
 	if (RenderComponent.NumRegisterComponent == 0) {
 		FoundSystem->LandscapeGpuRenderComponent_RenderThread.Remove(SubmitToRenderThreadComponentData.LandscapeKey);
@@ -258,14 +949,13 @@ void FMobileLandscapeGPURenderSystem_RenderThread::UnRegisterGPURenderLandscapeE
 	FoundSystem->NumAllRegisterComponents_RenderThread -= 1;
 	if (FoundSystem->NumAllRegisterComponents_RenderThread == 0) {
 		LandscapeGPURenderSystem_RenderThread.Remove(SubmitToRenderThreadComponentData.UniqueWorldId); //End of life of the system container
-		delete FoundSystem;
 	}
 }
 
 FMobileLandscapeGPURenderSystem_RenderThread* FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderSystem_RenderThread(const uint32 UniqueWorldId) {
-	FMobileLandscapeGPURenderSystem_RenderThread** FoundSystem = LandscapeGPURenderSystem_RenderThread.Find(UniqueWorldId);
+	TUniquePtr<FMobileLandscapeGPURenderSystem_RenderThread>* FoundSystem = LandscapeGPURenderSystem_RenderThread.Find(UniqueWorldId);
 	if (FoundSystem) {
-		return *FoundSystem;
+		return FoundSystem->Get();
 	}
 	else {
 		return nullptr;
@@ -273,7 +963,14 @@ FMobileLandscapeGPURenderSystem_RenderThread* FMobileLandscapeGPURenderSystem_Re
 }
 
 FLandscapeGpuRenderProxyComponent_RenderThread& FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderComponent_RenderThread(const uint32 UniqueWorldId, const FGuid& LandscapeKey) {
-	FMobileLandscapeGPURenderSystem_RenderThread* FoundSystem = LandscapeGPURenderSystem_RenderThread.FindChecked(UniqueWorldId);
-	FLandscapeGpuRenderProxyComponent_RenderThread& FoundRenderData = FoundSystem->LandscapeGpuRenderComponent_RenderThread.FindChecked(LandscapeKey);
+	FMobileLandscapeGPURenderSystem_RenderThread* FoundSystem = LandscapeGPURenderSystem_RenderThread.FindChecked(UniqueWorldId).Get();
+	FLandscapeGpuRenderProxyComponent_RenderThread& FoundRenderData = *FoundSystem->LandscapeGpuRenderComponent_RenderThread.FindChecked(LandscapeKey);
 	return FoundRenderData;
 }
+
+TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe> FMobileLandscapeGPURenderSystem_RenderThread::FindLandscapeGPURenderComponentHandle_RenderThread(const uint32 UniqueWorldId, const FGuid& LandscapeKey) {
+	check(IsInRenderingThread());
+	FMobileLandscapeGPURenderSystem_RenderThread* FoundSystem = GetLandscapeGPURenderSystem_RenderThread(UniqueWorldId);
+	const TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe>* FoundRenderData = FoundSystem ? FoundSystem->LandscapeGpuRenderComponent_RenderThread.Find(LandscapeKey) : nullptr;
+	return FoundRenderData ? *FoundRenderData : nullptr;
+}
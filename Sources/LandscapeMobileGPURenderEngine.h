@@ -1,29 +1,139 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "RHIUtilities.h"
+#include "RenderResource.h"
+#include "ShaderParameterMacros.h"
+#include "Math/Interval.h"
+#include "Serialization/BulkData.h"
 
 extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeGpuRender;
 extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileComputeShaderControl;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeStitchingIndexBuffer;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeUnifiedDraw;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeVirtualHeightmap;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeVirtualHeightmapPoolSize;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeGpuGrass;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeGpuGrassMaxInstances;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeClusterQuadtree;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeEarlyOccluder;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeEarlyOccluderMaxLod;
+extern ENGINE_API TAutoConsoleVariable<int32> CVarMobileLandscapeOccluderMaxTriangles;
 
 struct FLandscapeSubmitData;
+class FPrimitiveSceneProxy;
+class FRHIGPUBufferReadback;
+class IBulkDataIORequest;
 
-//Per ClusterVertexData
+//Per ClusterVertexData, bound as VET_UByte4N, the shader scales it back by 255
 struct FLandscapeClusterVertex
 {
-	//uint8 PositionX;
-	//uint8 PositionY;
-	//uint8 Blank_0; //Blank Data
-	//uint8 Blank_1; //Blank Data
-
-	float PositionX;
-	float PositionY;
+	uint8 PositionX;
+	uint8 PositionY;
+	uint8 EdgeFlagsX; //bit[0~4]: X is the last or penultimate column of LodN, bit5: X is the first column
+	uint8 EdgeFlagsY; //Same as EdgeFlagsX, for Y
 };
+static_assert(sizeof(FLandscapeClusterVertex) == 4, "FLandscapeClusterVertex must match VET_UByte4N");
 
 namespace LandscapeGpuRenderParameter {
 	static constexpr uint8 ClusterQuadSize = 16;
 	static constexpr uint8 ClusterLodCount = 5;
 	static constexpr uint8 FirstLod = 0;
-	static constexpr uint32 ClusterVertexDataSize = ClusterQuadSize * sizeof(FLandscapeClusterVertex);
+	static constexpr uint32 ClusterVertexDataSize = (ClusterQuadSize + 1) * (ClusterQuadSize + 1) * sizeof(FLandscapeClusterVertex);
+
+	//See FLandscapeClusterVertex, must match the shader
+	static constexpr uint8 VertexFirstEdgeFlag = 1 << 5;
+
+	//Quads are emitted in vertical strips of this width, two rows of a strip fit in the post-transform vertex cache of tile-based GPUs
+	static constexpr uint32 ClusterIndexStripQuads = 8;
+
+	//All Lods share one index buffer, the indices of LodN follow the ones of Lod0~LodN-1
+	static constexpr uint32 GetLodIndexCount(uint32 LodIndex) { return (ClusterQuadSize >> LodIndex) * (ClusterQuadSize >> LodIndex) * 6; }
+	static constexpr uint32 GetLodFirstIndex(uint32 LodIndex) { return LodIndex == 0 ? 0 : GetLodFirstIndex(LodIndex - 1) + GetLodIndexCount(LodIndex - 1); }
+
+	//Stitching index buffer: every Lod stores one variant per EdgeMask (bit0: Down, bit1: Left, bit2: Top, bit3: Right neighbor is coarser)
+	//The variants of LodN follow the ones of Lod0~LodN-1, and the clusters are drawn per (Lod, EdgeMask) bucket
+	static constexpr uint32 ClusterEdgeMaskCount = 16;
+	static constexpr uint32 GetSolidDrawBucketCount(bool bStitchingIndexBuffer) { return bStitchingIndexBuffer ? ClusterLodCount * ClusterEdgeMaskCount : ClusterLodCount; }
+
+	//Hole flags of a cluster, baked with the cluster bounds, see ALandscapeProxy::GetClusterHoleFlags
+	//The fully hole clusters are culled, the partially hole ones are drawn by the hole variant of their draw bucket with the masked material
+	static constexpr uint8 ClusterFullHoleFlag = 1 << 0;
+	static constexpr uint8 ClusterPartialHoleFlag = 1 << 1;
+	//Baked cluster bounds: the min and max packed heights (R << 8 | G) of the cluster vertices, Min | Max << 16
+	//The X and Y of a cluster follow from the cluster grid, see ALandscapeProxy::LandscapeClusterHeightRanges
+	static constexpr uint32 PackClusterHeightRange(uint16 MinHeight, uint16 MaxHeight) { return MinHeight | static_cast<uint32>(MaxHeight) << 16; }
+	static constexpr float GetClusterLocalHeight(uint32 PackedHeight) { return (static_cast<float>(PackedHeight) - 32768.f) / 128.f; } //Same as LandscapeDataAccess::GetLocalHeight
+	static constexpr uint32 GetClusterFirstQuad(uint32 ClusterIndex, uint32 ClusterSizePerSection) {
+		//The sections share their border vertices, so the last cluster of a section is one quad short
+		return (ClusterIndex & (ClusterSizePerSection - 1)) * ClusterQuadSize + ClusterIndex / ClusterSizePerSection * (ClusterSizePerSection * ClusterQuadSize - 1);
+	}
+	inline FBox GetLocalClusterBox(const FIntPoint& GlobalClusterIndex, uint32 ClusterSizePerSection, uint32 PackedHeightRange) {
+		return FBox(
+			FVector(GetClusterFirstQuad(GlobalClusterIndex.X, ClusterSizePerSection), GetClusterFirstQuad(GlobalClusterIndex.Y, ClusterSizePerSection), GetClusterLocalHeight(PackedHeightRange & 0xFFFF)),
+			FVector(GetClusterFirstQuad(GlobalClusterIndex.X + 1, ClusterSizePerSection), GetClusterFirstQuad(GlobalClusterIndex.Y + 1, ClusterSizePerSection), GetClusterLocalHeight(PackedHeightRange >> 16))
+		);
+	}
+
+	static constexpr uint32 ClusterHoleVariantCount = 2; //The hole variants follow all the solid draw buckets
+	static constexpr uint32 GetDrawBucketCount(bool bStitchingIndexBuffer) { return GetSolidDrawBucketCount(bStitchingIndexBuffer) * ClusterHoleVariantCount; }
+	static constexpr bool IsHoleDrawBucket(uint32 DrawBucket, bool bStitchingIndexBuffer) { return DrawBucket >= GetSolidDrawBucketCount(bStitchingIndexBuffer); }
+	static constexpr uint32 GetDrawBucketLod(uint32 DrawBucket, bool bStitchingIndexBuffer) {
+		return bStitchingIndexBuffer ? DrawBucket % GetSolidDrawBucketCount(true) / ClusterEdgeMaskCount : DrawBucket % GetSolidDrawBucketCount(false);
+	}
+	static constexpr uint32 GetDrawBucketFirstIndex(uint32 DrawBucket, bool bStitchingIndexBuffer) {
+		return bStitchingIndexBuffer
+			? GetLodFirstIndex(GetDrawBucketLod(DrawBucket, true)) * ClusterEdgeMaskCount + (DrawBucket % ClusterEdgeMaskCount) * GetLodIndexCount(GetDrawBucketLod(DrawBucket, true))
+			: GetLodFirstIndex(GetDrawBucketLod(DrawBucket, false));
+	}
+
+	//Unified draw: all the solid clusters in one indexed indirect draw over the Lod0 indices, the vertex shader collapses the Lod0 grid to the cluster Lod grid
+	//Just without the stitching index buffer, its args follow the ones of the draw buckets, see CVarMobileLandscapeUnifiedDraw
+	static constexpr uint32 UnifiedDrawBucket = GetDrawBucketCount(false);
+	static constexpr uint32 GetIndirectDrawCount(bool bStitchingIndexBuffer) { return bStitchingIndexBuffer ? GetDrawBucketCount(true) : UnifiedDrawBucket + 1; }
+
+	//Virtual heightmap: a LevelN page holds the heightmap mipN of 2^N x 2^N sections, every page has SectionVerts x SectionVerts texels
+	//The pages are stored level by level, LevelN follows Level0~LevelN-1, must match LandscapeGpuVirtualHeightmap.ush
+	static constexpr uint32 VirtualHeightmapLevelCount = ClusterLodCount;
+	static constexpr uint32 VirtualHeightmapInvalidSlot = 0xFFFFFFFF;
+	static constexpr uint32 VirtualHeightmapMaxPendingPages = 16;
+	static constexpr uint32 GetVirtualHeightmapPageDataSize(uint32 SectionVerts) { return SectionVerts * SectionVerts * sizeof(uint32); }
+	static inline FIntPoint GetVirtualHeightmapLevelPages(const FIntPoint& NumSectionPages, uint32 Level) {
+		return FIntPoint(FMath::DivideAndRoundUp(NumSectionPages.X, 1 << Level), FMath::DivideAndRoundUp(NumSectionPages.Y, 1 << Level));
+	}
+	static inline uint32 GetVirtualHeightmapLevelFirstPage(const FIntPoint& NumSectionPages, uint32 Level) {
+		uint32 FirstPage = 0;
+		for (uint32 LevelIndex = 0; LevelIndex < Level; ++LevelIndex) {
+			const FIntPoint LevelPages = GetVirtualHeightmapLevelPages(NumSectionPages, LevelIndex);
+			FirstPage += LevelPages.X * LevelPages.Y;
+		}
+		return FirstPage;
+	}
+
+	//Heightmap array: one entry per section, must match LandscapeGpuRenderVertexFactory.ush
+	//bit[0~5]: Array slice, bit[6~9]: First resident mip of the slice, bit[10~20]: Section texel X, bit[21~31]: Section texel Y
+	static constexpr uint32 HeightmapArrayMaxSlices = 1 << 6;
+	static constexpr uint32 HeightmapArrayMaxTexel = 1 << 11;
+	static constexpr uint32 PackHeightmapArraySection(uint32 Slice, uint32 FirstMip, uint32 TexelX, uint32 TexelY) {
+		return Slice | (FirstMip << 6) | (TexelX << 10) | (TexelY << 21);
+	}
+
+	//GPU grass: the visible clusters of Lod0~GrassClusterLodCount-1 spawn the instances, must match LandscapeGpuGrass.usf
+	//Their solid draw buckets come first, so they are the first clusters of the ordered cluster buffer
+	static constexpr uint32 GrassClusterLodCount = 2;
+	static constexpr uint32 GrassSamplesPerClusterSide = 8; //One sample per thread, a group per cluster
+	static constexpr uint32 GrassMaxVarieties = 4;
+	static constexpr uint32 GrassMaxDraws = 16; //Mesh sections of all varieties
+	static constexpr uint32 GrassInstanceStride = 5 * sizeof(FVector4); //Origin, 3 transform rows, lightmap bias, see FInstancedStaticMeshVertexFactory
+	static constexpr uint32 GetGrassDrawBucketCount(bool bStitchingIndexBuffer) { return bStitchingIndexBuffer ? GrassClusterLodCount * ClusterEdgeMaskCount : GrassClusterLodCount; }
+
+	//Runtime virtual texture pages are drawn with one cluster Lod picked from the page texel size, so the neighbors never need stitching
+	static constexpr uint32 GetVirtualTextureLod(float PageTexelWorldSize, float QuadWorldSize) {
+		uint32 Lod = 0;
+		while (Lod + 1 < ClusterLodCount && PageTexelWorldSize >= QuadWorldSize * (2 << Lod)) {
+			++Lod;
+		}
+		return Lod;
+	}
 }
 
 struct FLandscapeGpuRenderUserData {
@@ -37,14 +147,6 @@ struct FLandscapeClusterLODData_CPU {
 	uint32 ClusterLOD;
 };
 
-//
-struct FLandscapeClusterInputData_CPU {
-	FVector BoundCenter;
-	float Pad_0;
-	FVector BoundExtent;
-	float Pad_1;
-};
-
 //HUAWEI Error?
 struct FLandscapeClusterPackData_CPU {
 	uint32 ClusterIndexX : 8; //0~255, 
@@ -54,20 +156,180 @@ struct FLandscapeClusterPackData_CPU {
 	uint32 TopLod : 3;
 	uint32 RightLod : 3;
 	uint32 CenterLod : 3;
+	uint32 PartialHole : 1; //Drawn by the hole variant of the draw bucket
+};
+
+struct FLandscapeVirtualHeightmapPendingPage {
+	IBulkDataIORequest* IORequest;
+	uint8* PageData;
+	uint32 Slot;
+};
+
+/**
+ * Virtual heightmap, the pages of ULandscapeGpuVirtualHeightmap are streamed into a fixed atlas
+ * The culling CS requests the pages of the clusters in the frustum, the requests are read back some frames later
+ */
+struct FLandscapeVirtualHeightmap_RenderThread {
+	ENGINE_API FLandscapeVirtualHeightmap_RenderThread(const FByteBulkData* InPageBulkData, uint32 InSectionVerts, const FIntPoint& InNumSectionPages);
+	ENGINE_API ~FLandscapeVirtualHeightmap_RenderThread();
+
+	ENGINE_API void UpdatePages(FRHICommandListImmediate& RHICmdList); //Upload the streamed pages, resolve the requests and update the page table
+	ENGINE_API void EnqueuePageRequestReadback(FRHICommandList& RHICmdList);
+	void LoadPage(FRHICommandListImmediate& RHICmdList, uint32 PageIndex, uint32 Slot);
+	void UploadPage(FRHICommandListImmediate& RHICmdList, uint32 PageIndex, uint32 Slot, const uint8* PageData);
+	int32 AllocateSlot(uint32 RequestReadbackStamp);
+	inline uint32 GetAtlasSize() const { return SlotsPerRow * SectionVerts; }
+
+	//[Resources Ref]
+	const FByteBulkData* PageBulkData; //Owned by ULandscapeGpuVirtualHeightmap
+
+	//Just Write once
+	uint32 SectionVerts;
+	FIntPoint NumSectionPages; //Level0 pages, one per section
+	uint32 NumPages; //Pages of all levels
+	uint32 SlotsPerRow; //See CVarMobileLandscapeVirtualHeightmapPoolSize
+
+	//Write multiple times
+	uint32 RequestStamp; //Written to the requested pages by the culling CS, never 0
+	uint32 PageRequestReadbackStamp; //RequestStamp of the copy in flight, 0 if none
+	bool bPageTableDirty;
+
+	//[Resources Manager Auto Release]
+	TArray<uint32> PageTable_CPU; //Page -> Slot
+	TArray<int32> SlotToPage; //INDEX_NONE if the slot is free
+	TArray<uint32> SlotLastRequestStamp; //Least recently requested slots are evicted first
+	TMap<uint32, FLandscapeVirtualHeightmapPendingPage> PendingPages;
+
+	//[Resources Manager]
+	FTexture2DRHIRef PhysicalAtlas_GPU;
+	FReadBuffer PageTable_GPU;
+	FRWBuffer PageRequest_GPU;
+	FRHIGPUBufferReadback* PageRequestReadback;
+};
+
+/**
+ * Heightmap array, the landscapes imported with several heightmaps are drawn by one proxy
+ * Every heightmap is copied into a slice at its top left, and recopied when the streaming reallocates it
+ */
+struct FLandscapeHeightmapArray_RenderThread {
+	ENGINE_API FLandscapeHeightmapArray_RenderThread(const TArray<FTextureReferenceRHIRef>& InHeightmaps, const TArray<FIntPoint>& InHeightmapSizes, const TArray<uint32>& InSectionHeightmaps, const TArray<FIntPoint>& InSectionTexels);
+	ENGINE_API ~FLandscapeHeightmapArray_RenderThread();
+
+	ENGINE_API void UpdateSlices(FRHICommandListImmediate& RHICmdList); //Copy the reallocated heightmaps and update the section table
+	bool CopySlice(FRHICommandListImmediate& RHICmdList, uint32 Slice, FRHITexture* SourceTexture);
+	inline uint32 GetArraySize() const { return ArraySize; }
+
+	//Just Write once
+	uint32 ArraySize;
+	uint32 NumArrayMips; //The vertex shader samples mip = cluster Lod at most
+	TArray<FTextureReferenceRHIRef> Heightmaps; //Slice -> Heightmap
+	TArray<uint32> HeightmapNumMips; //Mips of the heightmap when fully streamed in
+	TArray<uint32> SectionHeightmaps; //Section -> Slice
+	TArray<FIntPoint> SectionTexels; //Section -> Texel of its first vertex in the heightmap
+
+	//Write multiple times
+	bool bSectionTableDirty;
+
+	//[Resources Manager Auto Release]
+	TArray<FTextureRHIRef> CopiedTextures; //Heightmap RHI texture of each slice when it was copied
+	TArray<uint32> SliceFirstMips;
+
+	//[Resources Manager]
+	FTexture2DArrayRHIRef HeightmapArray_GPU;
+	FReadBuffer SectionTable_GPU;
+};
+
+//A grass variety of a layer of the whole weightmaps, see ALandscapeProxy::GpuGrassLayers
+struct FLandscapeGpuGrassVariety {
+	uint32 WeightmapIndex; //Index of the whole weightmaps, 4 layers per weightmap
+	uint32 WeightmapChannel;
+	float SampleDensity; //Instances per grass sample at full weight, at most 1
+	FFloatInterval Scale;
+	bool bRandomRotation;
 };
 
+//An indirect draw of a mesh section of a grass variety
+struct FLandscapeGpuGrassDraw {
+	uint32 Variety;
+	uint32 FirstIndex;
+	uint32 IndexCount;
+};
+
+//Written by the grass CS and read as the instance streams of the grass vertex factories
+class FLandscapeGpuGrassInstanceBuffer : public FVertexBuffer {
+public:
+	explicit FLandscapeGpuGrassInstanceBuffer(uint32 InNumBytes) : NumBytes(InNumBytes) {}
+
+	ENGINE_API virtual void InitRHI() override;
+	ENGINE_API virtual void ReleaseRHI() override;
+
+	uint32 NumBytes;
+	FUnorderedAccessViewRHIRef UAV;
+};
+
+/**
+ * GPU grass, the instances are spawned every frame inside the visible Lod0 and Lod1 clusters after the culling
+ * The grass cost follows what is on screen instead of the loaded area
+ */
+struct FLandscapeGpuGrass_RenderThread {
+	ENGINE_API FLandscapeGpuGrass_RenderThread(const TArray<FLandscapeGpuGrassVariety>& InVarieties, const TArray<FLandscapeGpuGrassDraw>& InDraws, const TArray<FTextureReferenceRHIRef>& InWeightmaps, const FIntPoint& InWeightmapSize);
+	ENGINE_API ~FLandscapeGpuGrass_RenderThread();
+
+	inline uint32 GetFirstInstance(uint32 Variety) const { return Variety * MaxInstancesPerVariety; }
+
+	//Just Write once
+	uint32 MaxInstancesPerVariety; //See CVarMobileLandscapeGpuGrassMaxInstances, the extra instances are dropped
+	TArray<FLandscapeGpuGrassVariety> Varieties;
+	TArray<FLandscapeGpuGrassDraw> Draws;
+	TArray<FTextureReferenceRHIRef> Weightmaps; //Whole weightmaps of the proxy
+	FIntPoint WeightmapSize;
+
+	//Write multiple times
+	FVector InvLandscapeScale; //The instance transforms are in landscape space, the grass keeps its own size
+
+	//[Resources Manager]
+	FLandscapeGpuGrassInstanceBuffer InstanceBuffer;
+	FRWBuffer InstanceCount_GPU; //Per variety
+	FRWBuffer DispatchArgs_GPU; //One group per grass cluster
+	FRWBuffer DrawArgs_GPU; //Per draw
+};
+
+//The culling constants of a landscape, they change just with its GPU buffers or its transform, see LandscapeGpuCullingLandscape in LandscapeGpuRender.usf
+BEGIN_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeGpuCullingLandscapeParameters, ENGINE_API)
+	SHADER_PARAMETER(FMatrix, LocalToWorld)
+	SHADER_PARAMETER(FVector4, LodSettings) //(LastLODScreenSizeSquared, LOD1ScreenSizeSquared, LODOnePlusDistributionScalarSquared, LastLODIndex)
+	SHADER_PARAMETER(FVector4, LodParameters) //(LandscapeMaxAxisScale, ClusterSqureSizePerComponent, NumComponents, 0)
+	SHADER_PARAMETER(FUintVector4, LandscapeParameters) //(LandscapeComponentSizeX, LandscapeComponentSizeY, ComponentClusterSize, 0)
+	SHADER_PARAMETER(FUintVector4, ClusterInputParameters) //(ClusterSizePerSection, HoleFlagsOffset, 0, 0)
+END_GLOBAL_SHADER_PARAMETER_STRUCT()
+
 struct FLandscapeGpuRenderProxyComponent_RenderThread {
 	FLandscapeGpuRenderProxyComponent_RenderThread();
 	~FLandscapeGpuRenderProxyComponent_RenderThread();
 
-	ENGINE_API void UpdateAllGPUBuffer();
-	ENGINE_API void InitClusterData(const TArray<FBox>& ClusterBoundingArray, const FMatrix& LocalToWorldMatrix);
-	void RegisterComponentData(const FLandscapeSubmitData& SubmitToRenderThreadComponentData);
+	ENGINE_API bool UpdateAllGPUBuffer(); //Return true if the buffers are rebuilt
+	inline uint32 GetDrawBucketCount() const { return LandscapeGpuRenderParameter::GetDrawBucketCount(bStitchingIndexBuffer); }
+	inline uint32 GetIndirectDrawCount() const { return LandscapeGpuRenderParameter::GetIndirectDrawCount(bStitchingIndexBuffer); }
+	ENGINE_API void InitClusterData(TArray<uint32>&& InClusterHeightRanges, TArray<uint8>&& InClusterHoleFlags, const FMatrix& LocalToWorldMatrix);
+	ENGINE_API FBox GetLocalClusterBox(uint32 LinearIndex, uint32 PackedHeightRange) const; //From the height range and the cluster grid
+	inline FUintVector4 GetClusterInputParameters() const { return FUintVector4(ClusterSizePerSection, NumInputClusters, 0, 0); } //See ClusterInputParameters in LandscapeGpuRender.usf
+	ENGINE_API void ResolveLodHistogram();
+	ENGINE_API void EnqueueLodHistogramReadback(FRHICommandList& RHICmdList);
+	ENGINE_API const TArray<uint32>& GetDebugClusterHeightRanges(); //ClusterHeightRanges, read back from ClusterInputData_GPU once released
+	ENGINE_API void ResolveClusterInputReadback();
+	ENGINE_API void EnqueueClusterInputReadback(FRHICommandList& RHICmdList);
+	ENGINE_API SIZE_T GetCPUAllocatedSize() const;
+	ENGINE_API SIZE_T GetGPUAllocatedSize() const;
+	void RegisterComponentData(const FLandscapeSubmitData& SubmitToRenderThreadComponentData); //The caller marks dirty once per batch
 	void UnRegisterComponentData();
-	void MarkDirty();
+	ENGINE_API void MarkDirty(); //Called by the scene proxy
+	ENGINE_API void SetLocalToWorld(const FMatrix& InLocalToWorld); //Called by the scene proxy, just the culling uniform buffer is rebuilt
+	void UpdateCullingUniformBuffer();
+	void BuildOccluderMesh();
 	inline uint32 GetLinearIndexByClusterIndex(const FIntPoint& ClusterIndex) const;
 
 	bool bLandscapeDirty;
+	bool bStitchingIndexBuffer; //See CVarMobileLandscapeStitchingIndexBuffer
 
 	//Just Write once
 	uint32 NumSections;
@@ -81,23 +343,86 @@ struct FLandscapeGpuRenderProxyComponent_RenderThread {
 	FIntPoint LandscapeComponentMin;
 	FIntPoint LandscapeComponentSize;
 
+	//Write multiple times
+	FMatrix LocalToWorld; //The cluster data is in landscape space, the view is brought to it at cull time
+	FMatrix WorldToLocal;
+
 	//[Resources Ref]
 	FLandscapeGpuRenderUserData LandscapeGpuRenderUserData;
 
+	//[Resources Ref]
+	FPrimitiveSceneProxy* SceneProxy; //Its cached mesh draw commands reference the GPU buffers
+
+	//[Resources Value]
+	uint32 FinestDrawnLod; //Finest cluster Lod of the last resolved LodHistogram, the heightmap mips above it can be streamed out
+	TFunction<void(uint32)> OnFinestDrawnLodChanged; //Set by the scene proxy, feeds the heightmap streaming
+	TFunction<void()> OnAllocatedSizeChanged; //Set by the scene proxy, feeds the landscape memory stats
+
+	//[Resources Ref]
+	FLandscapeVirtualHeightmap_RenderThread* VirtualHeightmap; //Owned by the scene proxy, null without CVarMobileLandscapeVirtualHeightmap
+
+	//[Resources Ref]
+	FLandscapeHeightmapArray_RenderThread* HeightmapArray; //Owned by the scene proxy, null if the landscape has one heightmap
+
+	//[Resources Ref]
+	FLandscapeGpuGrass_RenderThread* Grass; //Owned by the scene proxy, null without CVarMobileLandscapeGpuGrass or grass layers
+
+	//[Resources Value]
+	uint32 NumInputClusters; //Kept after ClusterHeightRanges is released
+
+	//[Resources Manager Auto Release]
+	TArray<uint32> ClusterHeightRanges; //Uploaded as is, see ALandscapeProxy::LandscapeClusterHeightRanges, released after the upload in cooked builds
+
 	//[Resources Manager Auto Release]
-	TArray<FBoxSphereBounds> WorldClusterBounds;
+	TArray<uint8> ClusterHoleFlags; //Empty if the landscape has no hole, released with ClusterHeightRanges
+	bool bHasPartialHoleClusters; //The scene proxy draws the hole variants of the draw buckets just if set
 
 	//[Resources Manager Auto Release]
-	TArray<FVector4> ComponentsOriginAndRadius;
+	TArray<FVector4> ComponentsOriginAndRadius; //Landscape space, released with ClusterHeightRanges
+
+	//[Resources Manager Auto Release]
+	TSharedPtr<TArray<FVector>, ESPMode::ThreadSafe> OccluderVertices; //Landscape space, see CVarMobileLandscapeOccluderMaxTriangles
+	TSharedPtr<TArray<uint16>, ESPMode::ThreadSafe> OccluderIndices; //Null without occluder, the software occlusion keeps a reference while it rasterizes
 
 	//[Resources Manager]
 	FRWBuffer LandscapeClusterLODData_GPU;
 	FReadBuffer ComponentOriginAndRadius_GPU;
-	FRWBufferStructured ClusterInputData_GPU; //#todo: Read Only
+	FReadBuffer ClusterInputData_GPU; //ClusterHeightRanges then ClusterHoleFlags, see ClusterInputDataSRV in LandscapeGpuRender.usf
 	FRWBuffer ClusterOutputData_GPU;
 	FRWBuffer ClusterLodCountUAV_GPU;
 	FRWBuffer OrderClusterOutBufferUAV_GPU;
 	FRWBuffer IndirectDrawCommandBuffer_GPU;
+	FRWBuffer DrawBucketStart_GPU; //Just for StitchingIndexBuffer, the first instance of each draw bucket
+
+	//[Resources Manager Auto Release]
+	TUniformBufferRef<FLandscapeGpuCullingLandscapeParameters> CullingUniformBuffer; //Shared by the Lod, culling and occluder CS of every view
+
+	//[Resources Manager]
+	FRHIGPUBufferReadback* ClusterLodCountReadback; //Copy of ClusterLodCountUAV_GPU, read some frames later
+	bool bLodHistogramReadbackPending;
+
+	//[Resources Manager]
+	FRHIGPUBufferReadback* ClusterInputReadback; //Copy of ClusterInputData_GPU, just for the bounds debug draw
+	bool bClusterInputReadbackRequested;
+	bool bClusterInputReadbackPending;
+	TArray<uint32> ReadbackClusterHeightRanges;
+
+	//Runtime virtual texture pages, culled one page at a time against the page frustum, same layout as the main view buffers
+	//Allocated just if bVirtualTexture, the scene proxy sets it when the landscape writes to runtime virtual textures
+	bool bVirtualTexture;
+
+	//[Resources Ref]
+	FLandscapeGpuRenderUserData VirtualTextureUserData;
+
+	//[Resources Manager]
+	FRWBuffer VirtualTextureClusterOutputData_GPU;
+	FRWBuffer VirtualTextureClusterLodCount_GPU;
+	FRWBuffer VirtualTextureOrderClusterOutBuffer_GPU;
+	FRWBuffer VirtualTextureIndirectDrawCommandBuffer_GPU;
+	FRWBuffer VirtualTextureDrawBucketStart_GPU; //Just for StitchingIndexBuffer
+
+	//ClusterOutputData_GPU holds the main view culling of last frame, the early occluders are read from it
+	bool bClusterOutputHistoryValid;
 };
 
 /**
@@ -107,15 +432,16 @@ struct FMobileLandscapeGPURenderSystem_RenderThread {
 	FMobileLandscapeGPURenderSystem_RenderThread();
 	~FMobileLandscapeGPURenderSystem_RenderThread();
 
-	static TMap<uint32, FMobileLandscapeGPURenderSystem_RenderThread*> LandscapeGPURenderSystem_RenderThread;
-	ENGINE_API static void RegisterGPURenderLandscapeEntity_RenderThread(const FLandscapeSubmitData& SubmitToRenderThreadComponentData);
+	static TMap<uint32, TUniquePtr<FMobileLandscapeGPURenderSystem_RenderThread>> LandscapeGPURenderSystem_RenderThread; //Just touched by the render commands, the proxies keep their own handle
+	ENGINE_API static void RegisterGPURenderLandscapeEntities_RenderThread(TArrayView<const FLandscapeSubmitData> SubmitToRenderThreadComponentData); //Components of the same landscape
 	ENGINE_API static void UnRegisterGPURenderLandscapeEntity_RenderThread(const FLandscapeSubmitData& SubmitToRenderThreadComponentData);
 	ENGINE_API static FMobileLandscapeGPURenderSystem_RenderThread* GetLandscapeGPURenderSystem_RenderThread(const uint32 UniqueWorldId);
 	ENGINE_API static FLandscapeGpuRenderProxyComponent_RenderThread& GetLandscapeGPURenderComponent_RenderThread(const uint32 UniqueWorldId, const FGuid& LandscapeKey);
+	ENGINE_API static TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe> FindLandscapeGPURenderComponentHandle_RenderThread(const uint32 UniqueWorldId, const FGuid& LandscapeKey);
 
 	//[RenderThread]
 	uint32 NumAllRegisterComponents_RenderThread;
-	TMap<FGuid, FLandscapeGpuRenderProxyComponent_RenderThread> LandscapeGpuRenderComponent_RenderThread; //A System may have multiple Landscapes
+	TMap<FGuid, TSharedPtr<FLandscapeGpuRenderProxyComponent_RenderThread, ESPMode::ThreadSafe>> LandscapeGpuRenderComponent_RenderThread; //A System may have multiple Landscapes, the address of a render component never changes
 };
 
 
@@ -10,6 +10,9 @@
 #include "GameFramework/Actor.h"
 #include "PhysicsEngine/BodyInstance.h"
 #include "Async/AsyncWork.h"
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+#include "Async/Future.h"
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 #include "Engine/Texture.h"
 #include "PerPlatformProperties.h"
 #include "LandscapeComponent.h"
@@ -23,6 +26,8 @@ class ALandscapeProxy;
 class UHierarchicalInstancedStaticMeshComponent;
 class ULandscapeComponent;
 class ULandscapeGrassType;
+class ULandscapeGpuVirtualHeightmap;
+class FLandscapeGpuClusterQuadtree;
 class ULandscapeHeightfieldCollisionComponent;
 class ULandscapeInfo;
 class ULandscapeLayerInfoObject;
@@ -42,6 +47,16 @@ enum class ENavDataGatheringMode : uint8;
 LANDSCAPE_API extern bool GLandscapeEditModeActive;
 #endif
 
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+/** Result of ALandscapeProxy::BuildClusterBoundingBoxAsync, moved to the proxy on the game thread */
+struct FLandscapeClusterBoundsBuild
+{
+	TArray<uint32> HeightRanges;
+	TArray<uint16> Heights;
+	FIntPoint HeightsSize = FIntPoint::ZeroValue;
+};
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+
 USTRUCT()
 struct FLandscapeEditorLayerSettings
 {
@@ -375,6 +390,27 @@ struct  FWeightmapInfo
 };
 //@StarLight code - BEGIN Merge All Component's Weightmap to One Weightmap, Added by zhuyule
 
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+/** Grass spawned on the GPU by the GPU landscape, the density follows the layer in the whole weightmaps */
+USTRUCT()
+struct FLandscapeGpuGrassLayer
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** A layer of the landscape material, must be in WholeWeightmapLayerNames */
+	UPROPERTY(EditAnywhere, Category = GpuGrass)
+	FName LayerName;
+
+	UPROPERTY(EditAnywhere, Category = GpuGrass)
+	ULandscapeGrassType* GrassType;
+
+	FLandscapeGpuGrassLayer()
+		: GrassType(nullptr)
+	{
+	}
+};
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+
 class FLandscapeLayersTexture2DCPUReadBackResource : public FTextureResource
 {
 public:
@@ -609,8 +645,33 @@ public:
 	TArray<ULandscapeComponent*> LandscapeComponents;
 
 	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	/** Per cluster min and max packed heights, component by component, see LandscapeGpuRenderParameter::PackClusterHeightRange. Serialized as bulk data */
+	TArray<uint32> LandscapeClusterHeightRanges;
+
+#if WITH_EDITORONLY_DATA
+	/** The full boxes saved before LandscapeClusterHeightRanges, converted on load */
+	UPROPERTY()
+	TArray<FBox> LandscapeClusterBoundingBox_DEPRECATED;
+#endif
+
+	/** Per cluster hole flags, same layout as LandscapeClusterHeightRanges, empty if the landscape has no hole */
+	UPROPERTY()
+	TArray<uint8> LandscapeClusterHoleFlags;
+
+	/** Heightmap pages of the GPU landscape, built on save when r.GpuDriven.LandscapeVirtualHeightmap is set */
+	UPROPERTY()
+	ULandscapeGpuVirtualHeightmap* LandscapeGpuVirtualHeightmap;
+
+	/** Grass of the GPU landscape, spawned every frame inside the visible near clusters when r.GpuDriven.LandscapeGpuGrass is set */
+	UPROPERTY(EditAnywhere, Category = LandscapeGpuRender)
+	TArray<FLandscapeGpuGrassLayer> GpuGrassLayers;
+
+	/** Vertex heights over the whole landscape, row major, baked with the cluster bounds when r.GpuDriven.LandscapeClusterQuadtree is set */
+	UPROPERTY()
+	TArray<uint16> LandscapeClusterHeights;
+
 	UPROPERTY()
-	TArray<FBox> LandscapeClusterBoundingBox;
+	FIntPoint LandscapeClusterHeightsSize;
 	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 
 	/** Array of LandscapeHeightfieldCollisionComponent */
@@ -771,6 +832,12 @@ public:
 	TArray<FWeightmapInfo> WeightmapInfos;
 	//@StarLight code - BEGIN Merge All Component's Weightmap to One Weightmap, Added by zhuyule
 
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	/** Layer of every channel of WholeWeightmaps, four per weightmap, lets the GPU grass find its layer */
+	UPROPERTY()
+	TArray<FName> WholeWeightmapLayerNames;
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+
 	/** Data set at creation time */
 	UPROPERTY()
 	int32 ComponentSizeQuads;    // Total number of quads in each component
@@ -884,6 +951,9 @@ public:
 	// End blueprint functions
 
 	//~ Begin AActor Interface
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	virtual void PreRegisterAllComponents() override;
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 	virtual void PostRegisterAllComponents() override;
 	virtual void UnregisterAllComponents(bool bForReregister = false) override;
 	virtual void RerunConstructionScripts() override {}
@@ -1225,7 +1295,21 @@ private:
 
 public:
 	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
-	const TArray<FBox>& GetClusterBoundingBox(const FBox& ProxyLocalBox);
+	/** Editor: builds the cluster bounds on the worker threads and calls OnBuilt from there, cooked: calls it right away with the saved ones */
+	void BuildClusterBoundingBoxAsync(const FBox& ProxyLocalBox, TUniqueFunction<void(const TArray<uint32>&)>&& OnBuilt);
+	void FinishClusterBoundingBoxBuild(); //Waits for the pending build and keeps its result, before reading LandscapeClusterHeightRanges on the game thread
+	const TArray<uint8>& GetClusterHoleFlags(const FBox& ProxyLocalBox);
+	ULandscapeGpuVirtualHeightmap* GetGpuVirtualHeightmap();
+	TSharedPtr<const FLandscapeGpuClusterQuadtree> GetClusterQuadtree(); //Built on the game thread, then queried from any thread
+	bool DeferGpuRenderRegistration(ULandscapeComponent* Component); //True if the component waits for PostRegisterAllComponents
+	bool CancelDeferredGpuRenderRegistration(ULandscapeComponent* Component); //True if the component was still waiting, it was never submitted
+	TArray<ULandscapeComponent*> TakeDeferredGpuRenderComponents();
+
+private:
+	TSharedPtr<const FLandscapeGpuClusterQuadtree> ClusterQuadtree; //[Don't Serialize]
+	TFuture<FLandscapeClusterBoundsBuild> ClusterBoundingBoxBuild; //[Don't Serialize]
+	bool bDeferGpuRenderRegistration; //[Don't Serialize] Between Pre and PostRegisterAllComponents, the components are submitted in one batch
+	TArray<ULandscapeComponent*> DeferredGpuRenderComponents; //[Don't Serialize] Registered during the deferred window, the components registered before are not submitted again
 	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 };
 
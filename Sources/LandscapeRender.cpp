@@ -41,6 +41,9 @@ LandscapeRender.cpp: New terrain rendering
 #include "VT/RuntimeVirtualTexture.h"
 #include "RayTracingInstance.h"
 #include "ProfilingDebugging/LoadTimeTracker.h"
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+#include "LandscapeMobileGPURenderEngine.h"
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 
 IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeUniformShaderParameters, "LandscapeParameters");
 IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeFixedGridUniformShaderParameters, "LandscapeFixedGrid");
@@ -4242,7 +4245,11 @@ void ULandscapeComponent::GetStreamingRenderAssetInfo(FStreamingTextureLevelCont
 	}
 
 	// Heightmap
-	if (HeightmapTexture)
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+	//The GpuRender streams the heightmap by the drawn cluster Lods, see ULandscapeGpuRenderProxyComponent::GetStreamingRenderAssetInfo
+	const bool bHeightmapStreamedByGpuRender = CVarMobileLandscapeGpuRender.GetValueOnAnyThread() != 0 && FeatureLevel == ERHIFeatureLevel::ES3_1;
+	if (HeightmapTexture && !bHeightmapStreamedByGpuRender)
+	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 	{
 		FStreamingRenderAssetPrimitiveInfo& StreamingHeightmap = *new(OutStreamingRenderAssets)FStreamingRenderAssetPrimitiveInfo;
 		StreamingHeightmap.Bounds = BoundingSphere;
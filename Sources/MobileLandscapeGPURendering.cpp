@@ -7,17 +7,125 @@
 constexpr uint32 ThreadCount = 64;
 constexpr uint32 ThreadCount_1 = 8;
 
+//Mobile Hzb mip0 size and mip count, must match USE_LOW_RESLUTION of LandscapeGpuRender.usf
+constexpr uint32 HzbSizeX = 256;
+constexpr uint32 HzbSizeY = 128;
+constexpr uint32 HzbMipCount = 8;
+
+//Hzb of the early landscape occluders, same layout as the mobile Hzb but apart from it, so MobileGPUCulling keeps last frame's Hzb and matrix
+class FLandscapeOccluderHzb : public FRenderResource {
+public:
+	FRWBufferStructured& GetBuffer() {
+		if (!Buffer.Buffer) {
+			uint32 NumElements = 0;
+			for (uint32 Level = 0; Level < HzbMipCount; ++Level) {
+				NumElements += (HzbSizeX >> Level) * (HzbSizeY >> Level);
+			}
+			Buffer.Initialize(sizeof(uint32), NumElements);
+		}
+		return Buffer;
+	}
+
+	virtual void ReleaseRHI() override {
+		Buffer.Release();
+	}
+
+private:
+	FRWBufferStructured Buffer; //[Resources Manager] Created with the first early occluder pass
+};
+
+static TGlobalResource<FLandscapeOccluderHzb> GLandscapeOccluderHzb;
+
+//The Hzb read by the landscape culling, the early occluder one or last frame's mobile Hzb, see GetLandscapeHzbViewProjectionMatrix
+struct FLandscapeCullingHzb {
+	FRHIUnorderedAccessView* UAV;
+	FRHIShaderResourceView* SRV;
+
+	static FLandscapeCullingHzb GetForView(const FViewInfo& View) {
+		if (bUseLandscapeEarlyOccluder(View)) {
+			FRWBufferStructured& Buffer = GLandscapeOccluderHzb.GetBuffer();
+			return { Buffer.UAV, Buffer.SRV };
+		}
+		return { FMobileHzbSystem::GetStructuredBufferRes()->UAV, FMobileHzbSystem::GetStructuredBufferRes()->SRV };
+	}
+};
+
+//Bucket the clusters by (Lod, EdgeMask) instead of Lod, see CVarMobileLandscapeStitchingIndexBuffer
+class FLandscapeStitchingIndexBufferDim : SHADER_PERMUTATION_BOOL("LANDSCAPE_GPU_STITCHING_INDEX_BUFFER");
+
+//Request the virtual heightmap pages and cull the clusters without a resident page, see CVarMobileLandscapeVirtualHeightmap
+class FLandscapeVirtualHeightmapDim : SHADER_PERMUTATION_BOOL("LANDSCAPE_GPU_VIRTUAL_HEIGHTMAP");
+
+//Cull against the ortho frustum of a runtime virtual texture page, without occlusion and with one Lod for the page
+class FLandscapeVirtualTexturePageDim : SHADER_PERMUTATION_BOOL("LANDSCAPE_GPU_VIRTUAL_TEXTURE_PAGE");
+
+//The camera constants of the culling, built once per frame for all the landscapes, see LandscapeGpuCullingView in LandscapeGpuRender.usf
+BEGIN_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeGpuCullingViewParameters, )
+	SHADER_PARAMETER(FVector4, ViewOrigin)
+	SHADER_PARAMETER(FVector4, ProjMatrixParameters) //(ProjMatrix.M[0][0], ProjMatrix.M[1][1], ProjMatrix.M[2][3], 0)
+	SHADER_PARAMETER_ARRAY(FVector4, ViewFrustumPermutedPlanes, [8]) //World space, moved to landscape space by the culling CS
+	SHADER_PARAMETER(FMatrix, HzbViewProjectionMatrix) //World space, see GetLandscapeHzbViewProjectionMatrix
+END_GLOBAL_SHADER_PARAMETER_STRUCT()
+
+IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(FLandscapeGpuCullingViewParameters, "LandscapeGpuCullingView");
+
+static TUniformBufferRef<FLandscapeGpuCullingViewParameters> CreateLandscapeGpuCullingViewUniformBuffer(const FViewInfo& View) {
+	FLandscapeGpuCullingViewParameters Parameters;
+	const FMatrix& ProjMatrix = View.ViewMatrices.GetProjectionMatrix();
+	Parameters.ViewOrigin = FVector4(View.ViewMatrices.GetViewOrigin(), 0.f);
+	Parameters.ProjMatrixParameters = FVector4(ProjMatrix.M[0][0], ProjMatrix.M[1][1], ProjMatrix.M[2][3], 0.f);
+	const FConvexVolume::FPermutedPlaneArray& PermutedPlanes = View.ViewFrustum.PermutedPlanes;
+	for (int32 PlaneIndex = 0; PlaneIndex < 8; ++PlaneIndex) {
+		const FPlane Plane = PlaneIndex < PermutedPlanes.Num() ? PermutedPlanes[PlaneIndex] : FPlane(0.f, 0.f, 0.f, 0.f);
+		Parameters.ViewFrustumPermutedPlanes[PlaneIndex] = FVector4(Plane.X, Plane.Y, Plane.Z, Plane.W);
+	}
+	Parameters.HzbViewProjectionMatrix = GetLandscapeHzbViewProjectionMatrix(View);
+	return TUniformBufferRef<FLandscapeGpuCullingViewParameters>::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+}
+
+//The buffers written by a culling pass, the main view and the runtime virtual texture pages have their own
+struct FLandscapeClusterCullingOutput {
+	const FRWBuffer& ClusterOutputData;
+	const FRWBuffer& ClusterLodCount;
+	const FRWBuffer& OrderClusterOutBuffer;
+	const FRWBuffer& IndirectDrawCommandBuffer;
+	const FRWBuffer& DrawBucketStart;
+
+	static FLandscapeClusterCullingOutput GetMainView(const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+		return { RenderComponentData.ClusterOutputData_GPU, RenderComponentData.ClusterLodCountUAV_GPU, RenderComponentData.OrderClusterOutBufferUAV_GPU,
+			RenderComponentData.IndirectDrawCommandBuffer_GPU, RenderComponentData.DrawBucketStart_GPU };
+	}
+
+	static FLandscapeClusterCullingOutput GetVirtualTexture(const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+		return { RenderComponentData.VirtualTextureClusterOutputData_GPU, RenderComponentData.VirtualTextureClusterLodCount_GPU, RenderComponentData.VirtualTextureOrderClusterOutBuffer_GPU,
+			RenderComponentData.VirtualTextureIndirectDrawCommandBuffer_GPU, RenderComponentData.VirtualTextureDrawBucketStart_GPU };
+	}
+};
+
+//The cluster bounds are in landscape space, the frustum planes are moved there instead of the bounds
+static FConvexVolume GetLandscapeSpaceFrustum(const FConvexVolume& WorldFrustum, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+	FConvexVolume LocalFrustum;
+	for (const FPlane& Plane : WorldFrustum.Planes) {
+		LocalFrustum.Planes.Add(Plane.TransformBy(RenderComponentData.WorldToLocal));
+	}
+	LocalFrustum.Init();
+	return LocalFrustum;
+}
+
 class FComputeLandscapeLodCS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FComputeLandscapeLodCS);
 
 public:
+	using FPermutationDomain = TShaderPermutationDomain<FLandscapeStitchingIndexBufferDim>;
+
 	FComputeLandscapeLodCS() : FGlobalShader() {}
 
 	FComputeLandscapeLodCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
 		: FGlobalShader(Initializer) 
 	{
-		LodCSParameters.Bind(Initializer.ParameterMap, TEXT("LodCSParameters"));
+		LandscapeGpuCullingView.Bind(Initializer.ParameterMap, TEXT("LandscapeGpuCullingView"));
+		LandscapeGpuCullingLandscape.Bind(Initializer.ParameterMap, TEXT("LandscapeGpuCullingLandscape"));
 		ComponentsOriginAndRadiusSRV.Bind(Initializer.ParameterMap, TEXT("ComponentsOriginAndRadiusSRV"));
 		ClusterLodBufferUAV.Bind(Initializer.ParameterMap, TEXT("ClusterLodBufferUAV"));
 		ClusterLodCountUAV_0.Bind(Initializer.ParameterMap, TEXT("ClusterLodCountUAV_0"));
@@ -27,18 +135,9 @@ public:
 		return true;
 	}
 
-	void BindParameters(FRHICommandList& RHICmdList, const FViewInfo& View, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
-
-		//TArray<FVector4, TInlineAllocator<4>> 
-		//See detailed definition in shader
-		FVector4 PackConstBufferData[3];
-		constexpr auto PackConstBufferSize = UE_ARRAY_COUNT(PackConstBufferData);
-		const auto& ProjMatrix = View.ViewMatrices.GetProjectionMatrix();
-		const float ClusterSqureSizePerComponent = FMath::Square(RenderComponentData.NumSections * RenderComponentData.ClusterSizePerSection);
-		PackConstBufferData[0] = FVector4(View.ViewMatrices.GetViewOrigin(), 0.f);
-		PackConstBufferData[1] = FVector4( ProjMatrix.M[0][0], ProjMatrix.M[1][1], ProjMatrix.M[2][3], ClusterSqureSizePerComponent);
-		PackConstBufferData[2] = RenderComponentData.LodSettingParameters;
-		SetShaderValueArray(RHICmdList, RHICmdList.GetBoundComputeShader(), LodCSParameters, PackConstBufferData, PackConstBufferSize);//#TODO: 去掉远近平面? 
+	void BindParameters(FRHICommandList& RHICmdList, FRHIUniformBuffer* ViewUniformBuffer, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+		SetUniformBufferParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeGpuCullingView, ViewUniformBuffer);
+		SetUniformBufferParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeGpuCullingLandscape, RenderComponentData.CullingUniformBuffer);
 
 		//Barrier Batch
 		FRHITransitionInfo GpuCullingPassBarriers[] = {
@@ -58,7 +157,8 @@ public:
 	}
 
 private:
-	LAYOUT_FIELD(FShaderParameter, LodCSParameters);
+	LAYOUT_FIELD(FShaderUniformBufferParameter, LandscapeGpuCullingView);
+	LAYOUT_FIELD(FShaderUniformBufferParameter, LandscapeGpuCullingLandscape);
 	LAYOUT_FIELD(FShaderResourceParameter, ComponentsOriginAndRadiusSRV);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterLodBufferUAV);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterLodCountUAV_0);
@@ -69,14 +169,17 @@ class FLandscapeGpuCullingCS : public FGlobalShader
 	DECLARE_GLOBAL_SHADER(FLandscapeGpuCullingCS);
 
 public:
+	using FPermutationDomain = TShaderPermutationDomain<FLandscapeStitchingIndexBufferDim, FLandscapeVirtualHeightmapDim, FLandscapeVirtualTexturePageDim>;
+
 	FLandscapeGpuCullingCS() : FGlobalShader() {}
 
 	FLandscapeGpuCullingCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
 		: FGlobalShader(Initializer)
 	{
-		LandscapeParameters.Bind(Initializer.ParameterMap, TEXT("LandscapeParameters"));
-		ViewFrustumPermutedPlanes.Bind(Initializer.ParameterMap, TEXT("ViewFrustumPermutedPlanes"));
-		LastFrameViewProjectMatrix.Bind(Initializer.ParameterMap, TEXT("LastFrameViewProjectMatrix"));
+		LandscapeGpuCullingView.Bind(Initializer.ParameterMap, TEXT("LandscapeGpuCullingView"));
+		LandscapeGpuCullingLandscape.Bind(Initializer.ParameterMap, TEXT("LandscapeGpuCullingLandscape"));
+		VirtualTexturePagePermutedPlanes.Bind(Initializer.ParameterMap, TEXT("VirtualTexturePagePermutedPlanes"));
+		VirtualTexturePageLod.Bind(Initializer.ParameterMap, TEXT("VirtualTexturePageLod"));
 
 		ClusterInputDataSRV.Bind(Initializer.ParameterMap, TEXT("ClusterInputDataSRV"));
 		HzbResourceBufferSRV.Bind(Initializer.ParameterMap, TEXT("HzbResourceBufferSRV"));
@@ -84,26 +187,19 @@ public:
 
 		ClusterOutBufferUAV.Bind(Initializer.ParameterMap, TEXT("ClusterOutBufferUAV"));
 		ClusterLodCountUAV.Bind(Initializer.ParameterMap, TEXT("ClusterLodCountUAV"));
+
+		VirtualHeightmapParameters.Bind(Initializer.ParameterMap, TEXT("VirtualHeightmapParameters"));
+		VirtualHeightmapPageTableSRV.Bind(Initializer.ParameterMap, TEXT("VirtualHeightmapPageTableSRV"));
+		VirtualHeightmapPageRequestUAV.Bind(Initializer.ParameterMap, TEXT("VirtualHeightmapPageRequestUAV"));
 	}
 
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
 		return true;
 	}
 
-	void BindParameters(FRHICommandList& RHICmdList, const FViewInfo& View, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
-
-		//TArray<FVector4, TInlineAllocator<4>> 
-		//See detailed definition in shader
-		FUintVector4 PackConstBuffer = FUintVector4(
-			RenderComponentData.LandscapeComponentSize.X, 
-			RenderComponentData.LandscapeComponentSize.Y, 
-			RenderComponentData.ClusterSizePerSection * RenderComponentData.NumSections,
-			0
-		);
-
-		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeParameters, PackConstBuffer);
-		SetShaderValueArray(RHICmdList, RHICmdList.GetBoundComputeShader(), ViewFrustumPermutedPlanes, View.ViewFrustum.PermutedPlanes.GetData(), View.ViewFrustum.PermutedPlanes.Num());
-		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), LastFrameViewProjectMatrix, View.PrevViewInfo.ViewMatrices.GetViewProjectionMatrix());
+	//The view planes and the Hzb matrix are moved to landscape space in the shader
+	void BindParameters(FRHICommandList& RHICmdList, FRHIUniformBuffer* ViewUniformBuffer, const FLandscapeCullingHzb& Hzb, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+		SetUniformBufferParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeGpuCullingView, ViewUniformBuffer);
 
 		//Barrier Batch
 		FRHITransitionInfo GpuCullingPassBarriers[] = {
@@ -111,31 +207,70 @@ public:
 			FRHITransitionInfo(RenderComponentData.ClusterOutputData_GPU.UAV, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute), //WAR
 			FRHITransitionInfo(RenderComponentData.ClusterLodCountUAV_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute), //WAW
 			//#todo: batch?
-			FRHITransitionInfo(FMobileHzbSystem::GetStructuredBufferRes()->UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
+			FRHITransitionInfo(Hzb.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
 		};
 		RHICmdList.Transition(MakeArrayView(GpuCullingPassBarriers, UE_ARRAY_COUNT(GpuCullingPassBarriers)));
 
-		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterInputDataSRV, RenderComponentData.ClusterInputData_GPU.SRV);
 		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodBufferSRV, RenderComponentData.LandscapeClusterLODData_GPU.SRV);
-		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbResourceBufferSRV, FMobileHzbSystem::GetStructuredBufferRes()->SRV);
-		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterOutBufferUAV, RenderComponentData.ClusterOutputData_GPU.UAV);
-		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodCountUAV, RenderComponentData.ClusterLodCountUAV_GPU.UAV);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbResourceBufferSRV, Hzb.SRV);
+		BindCommonParameters(RHICmdList, RenderComponentData, FLandscapeClusterCullingOutput::GetMainView(RenderComponentData));
+	}
+
+	//The page has no occlusion and no per cluster Lod, its frustum and Lod change with every page so they stay loose parameters
+	void BindVirtualTexturePageParameters(FRHICommandList& RHICmdList, const FConvexVolume& PageFrustum, uint32 PageLod, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+		const FConvexVolume LocalFrustum = GetLandscapeSpaceFrustum(PageFrustum, RenderComponentData);
+		check(LocalFrustum.PermutedPlanes.Num() == 8);
+		SetShaderValueArray(RHICmdList, RHICmdList.GetBoundComputeShader(), VirtualTexturePagePermutedPlanes, LocalFrustum.PermutedPlanes.GetData(), LocalFrustum.PermutedPlanes.Num());
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), VirtualTexturePageLod, PageLod);
+
+		const FLandscapeClusterCullingOutput CullingOutput = FLandscapeClusterCullingOutput::GetVirtualTexture(RenderComponentData);
+		FRHITransitionInfo GpuCullingPassBarriers[] = {
+			FRHITransitionInfo(CullingOutput.ClusterOutputData.UAV, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute), //WAR
+			FRHITransitionInfo(CullingOutput.ClusterLodCount.UAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute), //WAW, cleared before
+		};
+		RHICmdList.Transition(MakeArrayView(GpuCullingPassBarriers, UE_ARRAY_COUNT(GpuCullingPassBarriers)));
+		BindCommonParameters(RHICmdList, RenderComponentData, CullingOutput);
+	}
+
+	void BindCommonParameters(FRHICommandList& RHICmdList, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData, const FLandscapeClusterCullingOutput& CullingOutput) {
+		SetUniformBufferParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeGpuCullingLandscape, RenderComponentData.CullingUniformBuffer);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterInputDataSRV, RenderComponentData.ClusterInputData_GPU.SRV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterOutBufferUAV, CullingOutput.ClusterOutputData.UAV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodCountUAV, CullingOutput.ClusterLodCount.UAV);
+
+		if (const FLandscapeVirtualHeightmap_RenderThread* VirtualHeightmap = RenderComponentData.VirtualHeightmap) {
+			FUintVector4 VirtualHeightmapPackConstBuffer = FUintVector4(
+				VirtualHeightmap->RequestStamp,
+				VirtualHeightmap->NumSectionPages.X,
+				VirtualHeightmap->NumSectionPages.Y,
+				RenderComponentData.ClusterSizePerSection
+			);
+			RHICmdList.Transition(FRHITransitionInfo(VirtualHeightmap->PageRequest_GPU.UAV, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute)); //WAR
+			SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), VirtualHeightmapParameters, VirtualHeightmapPackConstBuffer);
+			SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), VirtualHeightmapPageTableSRV, VirtualHeightmap->PageTable_GPU.SRV);
+			SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), VirtualHeightmapPageRequestUAV, VirtualHeightmap->PageRequest_GPU.UAV);
+		}
 	}
 
 	void UnBindParameters(FRHICommandList& RHICmdList) {
 		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterOutBufferUAV, nullptr);
 		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodCountUAV, nullptr); //#todo: Always Bind ?
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), VirtualHeightmapPageRequestUAV, nullptr);
 	}
 
 private:
-	LAYOUT_FIELD(FShaderParameter, LandscapeParameters);
-	LAYOUT_FIELD(FShaderParameter, ViewFrustumPermutedPlanes);
-	LAYOUT_FIELD(FShaderParameter, LastFrameViewProjectMatrix);
+	LAYOUT_FIELD(FShaderUniformBufferParameter, LandscapeGpuCullingView);
+	LAYOUT_FIELD(FShaderUniformBufferParameter, LandscapeGpuCullingLandscape);
+	LAYOUT_FIELD(FShaderParameter, VirtualTexturePagePermutedPlanes);
+	LAYOUT_FIELD(FShaderParameter, VirtualTexturePageLod);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterInputDataSRV);
 	LAYOUT_FIELD(FShaderResourceParameter, HzbResourceBufferSRV);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterLodBufferSRV);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterOutBufferUAV);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterLodCountUAV);
+	LAYOUT_FIELD(FShaderParameter, VirtualHeightmapParameters);
+	LAYOUT_FIELD(FShaderResourceParameter, VirtualHeightmapPageTableSRV);
+	LAYOUT_FIELD(FShaderResourceParameter, VirtualHeightmapPageRequestUAV);
 };
 
 class FLandscapeGpuSortedCS : public FGlobalShader
@@ -143,6 +278,8 @@ class FLandscapeGpuSortedCS : public FGlobalShader
 	DECLARE_GLOBAL_SHADER(FLandscapeGpuSortedCS);
 
 public:
+	using FPermutationDomain = TShaderPermutationDomain<FLandscapeStitchingIndexBufferDim>;
+
 	FLandscapeGpuSortedCS() : FGlobalShader() {}
 
 	FLandscapeGpuSortedCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
@@ -150,46 +287,329 @@ public:
 	{
 		ClusterOutBufferSRV.Bind(Initializer.ParameterMap, TEXT("ClusterOutBufferSRV"));
 		ClusterLodCountSRV.Bind(Initializer.ParameterMap, TEXT("ClusterLodCountSRV"));
+		NumClusterParameter.Bind(Initializer.ParameterMap, TEXT("NumClusterParameter"));
 		OrderClusterOutBufferUAV.Bind(Initializer.ParameterMap, TEXT("OrderClusterOutBufferUAV"));
 		DrawCommandBufferUAV.Bind(Initializer.ParameterMap, TEXT("DrawCommandBufferUAV"));
+		DrawBucketStartUAV.Bind(Initializer.ParameterMap, TEXT("DrawBucketStartUAV"));
 	}
 
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
 		return true;
 	}
 
-	void BindParameters(FRHICommandList& RHICmdList, const FViewInfo& View, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+	void BindParameters(FRHICommandList& RHICmdList, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData, const FLandscapeClusterCullingOutput& CullingOutput) {
 		//Barrier Batch
 		FRHITransitionInfo GpuCullingPassBarriers[] = {
-			FRHITransitionInfo(RenderComponentData.ClusterOutputData_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
-			FRHITransitionInfo(RenderComponentData.ClusterLodCountUAV_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
-			FRHITransitionInfo(RenderComponentData.OrderClusterOutBufferUAV_GPU.UAV, ERHIAccess::SRVGraphics, ERHIAccess::UAVCompute), //WAR
-			FRHITransitionInfo(RenderComponentData.IndirectDrawCommandBuffer_GPU.UAV, ERHIAccess::IndirectArgs, ERHIAccess::UAVCompute) //WAR
+			FRHITransitionInfo(CullingOutput.ClusterOutputData.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
+			FRHITransitionInfo(CullingOutput.ClusterLodCount.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
+			FRHITransitionInfo(CullingOutput.OrderClusterOutBuffer.UAV, ERHIAccess::SRVGraphics, ERHIAccess::UAVCompute), //WAR
+			FRHITransitionInfo(CullingOutput.IndirectDrawCommandBuffer.UAV, ERHIAccess::IndirectArgs, ERHIAccess::UAVCompute) //WAR
 		};
 		RHICmdList.Transition(MakeArrayView(GpuCullingPassBarriers, UE_ARRAY_COUNT(GpuCullingPassBarriers)));
+		if (RenderComponentData.bStitchingIndexBuffer) {
+			RHICmdList.Transition(FRHITransitionInfo(CullingOutput.DrawBucketStart.UAV, ERHIAccess::SRVGraphics, ERHIAccess::UAVCompute)); //WAR
+		}
 
-		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterOutBufferSRV, RenderComponentData.ClusterOutputData_GPU.SRV);
-		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodCountSRV, RenderComponentData.ClusterLodCountUAV_GPU.SRV);
-		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), OrderClusterOutBufferUAV, RenderComponentData.OrderClusterOutBufferUAV_GPU.UAV);
-		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), DrawCommandBufferUAV, RenderComponentData.IndirectDrawCommandBuffer_GPU.UAV);
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), NumClusterParameter, RenderComponentData.ClusterSizeX * RenderComponentData.ClusterSizeY);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterOutBufferSRV, CullingOutput.ClusterOutputData.SRV);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodCountSRV, CullingOutput.ClusterLodCount.SRV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), OrderClusterOutBufferUAV, CullingOutput.OrderClusterOutBuffer.UAV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), DrawCommandBufferUAV, CullingOutput.IndirectDrawCommandBuffer.UAV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), DrawBucketStartUAV, CullingOutput.DrawBucketStart.UAV);
 	}
 
 	void UnBindParameters(FRHICommandList& RHICmdList) {
 		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), OrderClusterOutBufferUAV, nullptr);
 		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), DrawCommandBufferUAV, nullptr); //#todo: Always Bind ?
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), DrawBucketStartUAV, nullptr);
 	}
 
 private:
 
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterOutBufferSRV);
 	LAYOUT_FIELD(FShaderResourceParameter, ClusterLodCountSRV);
+	LAYOUT_FIELD(FShaderParameter, NumClusterParameter);
 	LAYOUT_FIELD(FShaderResourceParameter, OrderClusterOutBufferUAV);
 	LAYOUT_FIELD(FShaderResourceParameter, DrawCommandBufferUAV);
+	LAYOUT_FIELD(FShaderResourceParameter, DrawBucketStartUAV);
+};
+
+//GPU grass, see FLandscapeGpuGrass_RenderThread
+//The heightmap is sampled through the landscape uniform buffer, which is declared by the Landscape module, so it is bound by name
+class FLandscapeGpuGrassPrepareCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FLandscapeGpuGrassPrepareCS);
+
+public:
+	FLandscapeGpuGrassPrepareCS() : FGlobalShader() {}
+
+	FLandscapeGpuGrassPrepareCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		GrassParameters.Bind(Initializer.ParameterMap, TEXT("GrassParameters"));
+		ClusterLodCountSRV.Bind(Initializer.ParameterMap, TEXT("ClusterLodCountSRV"));
+		GrassDispatchArgsUAV.Bind(Initializer.ParameterMap, TEXT("GrassDispatchArgsUAV"));
+		GrassInstanceCountUAV.Bind(Initializer.ParameterMap, TEXT("GrassInstanceCountUAV"));
+	}
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return true;
+	}
+
+	void BindParameters(FRHICommandList& RHICmdList, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData, const FUintVector4& PackConstBuffer) {
+		const FLandscapeGpuGrass_RenderThread& Grass = *RenderComponentData.Grass;
+
+		//Barrier Batch
+		FRHITransitionInfo GpuGrassPrepareBarriers[] = {
+			FRHITransitionInfo(Grass.DispatchArgs_GPU.UAV, ERHIAccess::IndirectArgs, ERHIAccess::UAVCompute), //WAR
+			FRHITransitionInfo(Grass.InstanceCount_GPU.UAV, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute), //WAR
+		};
+		RHICmdList.Transition(MakeArrayView(GpuGrassPrepareBarriers, UE_ARRAY_COUNT(GpuGrassPrepareBarriers)));
+
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassParameters, PackConstBuffer);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterLodCountSRV, RenderComponentData.ClusterLodCountUAV_GPU.SRV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassDispatchArgsUAV, Grass.DispatchArgs_GPU.UAV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceCountUAV, Grass.InstanceCount_GPU.UAV);
+	}
+
+	void UnBindParameters(FRHICommandList& RHICmdList) {
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassDispatchArgsUAV, nullptr);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceCountUAV, nullptr);
+	}
+
+private:
+	LAYOUT_FIELD(FShaderParameter, GrassParameters);
+	LAYOUT_FIELD(FShaderResourceParameter, ClusterLodCountSRV);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassDispatchArgsUAV);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassInstanceCountUAV);
+};
+
+class FLandscapeGpuGrassGenerateCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FLandscapeGpuGrassGenerateCS);
+
+public:
+	FLandscapeGpuGrassGenerateCS() : FGlobalShader() {}
+
+	FLandscapeGpuGrassGenerateCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		GrassParameters.Bind(Initializer.ParameterMap, TEXT("GrassParameters"));
+		GrassVarietyParameters.Bind(Initializer.ParameterMap, TEXT("GrassVarietyParameters"));
+		GrassLandscapeParameters.Bind(Initializer.ParameterMap, TEXT("GrassLandscapeParameters"));
+		LandscapeGpuRenderUniformBuffer.Bind(Initializer.ParameterMap, TEXT("LandscapeGpuRenderUniformBuffer"));
+		OrderClusterOutBufferSRV.Bind(Initializer.ParameterMap, TEXT("OrderClusterOutBufferSRV"));
+		GrassWeightmap0.Bind(Initializer.ParameterMap, TEXT("GrassWeightmap0"));
+		GrassWeightmap1.Bind(Initializer.ParameterMap, TEXT("GrassWeightmap1"));
+		GrassWeightmapSampler.Bind(Initializer.ParameterMap, TEXT("GrassWeightmapSampler"));
+		GrassInstanceBufferUAV.Bind(Initializer.ParameterMap, TEXT("GrassInstanceBufferUAV"));
+		GrassInstanceCountUAV.Bind(Initializer.ParameterMap, TEXT("GrassInstanceCountUAV"));
+	}
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return true;
+	}
+
+	void BindParameters(FRHICommandList& RHICmdList, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData, const FUintVector4& PackConstBuffer) {
+		const FLandscapeGpuGrass_RenderThread& Grass = *RenderComponentData.Grass;
+
+		//See detailed definition in shader
+		FVector4 VarietyPackConstBuffer[LandscapeGpuRenderParameter::GrassMaxVarieties * 2];
+		FMemory::Memzero(VarietyPackConstBuffer);
+		for (int32 VarietyIndex = 0; VarietyIndex < Grass.Varieties.Num(); ++VarietyIndex) {
+			const FLandscapeGpuGrassVariety& Variety = Grass.Varieties[VarietyIndex];
+			VarietyPackConstBuffer[VarietyIndex * 2] = FVector4(Variety.WeightmapIndex, Variety.WeightmapChannel, Variety.SampleDensity, Variety.bRandomRotation ? 1.f : 0.f);
+			VarietyPackConstBuffer[VarietyIndex * 2 + 1] = FVector4(Variety.Scale.Min, Variety.Scale.Max, 0.f, 0.f);
+		}
+		FVector4 LandscapePackConstBuffer[2] = {
+			FVector4(Grass.InvLandscapeScale, 0.f),
+			FVector4(1.f / FMath::Max(Grass.WeightmapSize.X, 1), 1.f / FMath::Max(Grass.WeightmapSize.Y, 1), 0.f, 0.f)
+		};
+
+		//Barrier Batch
+		FRHITransitionInfo GpuGrassGenerateBarriers[] = {
+			FRHITransitionInfo(Grass.DispatchArgs_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::IndirectArgs), //RAW
+			FRHITransitionInfo(Grass.InstanceCount_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute), //WAW
+			FRHITransitionInfo(Grass.InstanceBuffer.UAV, ERHIAccess::VertexOrIndexBuffer, ERHIAccess::UAVCompute), //WAR
+		};
+		RHICmdList.Transition(MakeArrayView(GpuGrassGenerateBarriers, UE_ARRAY_COUNT(GpuGrassGenerateBarriers)));
+
+		FRHITexture* Weightmap0 = Grass.Weightmaps[0];
+		FRHITexture* Weightmap1 = Grass.Weightmaps.Num() > 1 ? Grass.Weightmaps[1].GetReference() : GBlackTexture->TextureRHI.GetReference();
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassParameters, PackConstBuffer);
+		SetShaderValueArray(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassVarietyParameters, VarietyPackConstBuffer, UE_ARRAY_COUNT(VarietyPackConstBuffer));
+		SetShaderValueArray(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassLandscapeParameters, LandscapePackConstBuffer, UE_ARRAY_COUNT(LandscapePackConstBuffer));
+		SetUniformBufferParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeGpuRenderUniformBuffer, RenderComponentData.LandscapeGpuRenderUserData.LandscapeGpuRenderUniformBuffer);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), OrderClusterOutBufferSRV, RenderComponentData.OrderClusterOutBufferUAV_GPU.SRV);
+		SetTextureParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassWeightmap0, GrassWeightmapSampler, TStaticSamplerState<SF_Bilinear>::GetRHI(), Weightmap0);
+		SetTextureParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassWeightmap1, Weightmap1);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceBufferUAV, Grass.InstanceBuffer.UAV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceCountUAV, Grass.InstanceCount_GPU.UAV);
+	}
+
+	void UnBindParameters(FRHICommandList& RHICmdList) {
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceBufferUAV, nullptr);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceCountUAV, nullptr);
+	}
+
+private:
+	LAYOUT_FIELD(FShaderParameter, GrassParameters);
+	LAYOUT_FIELD(FShaderParameter, GrassVarietyParameters);
+	LAYOUT_FIELD(FShaderParameter, GrassLandscapeParameters);
+	LAYOUT_FIELD(FShaderUniformBufferParameter, LandscapeGpuRenderUniformBuffer);
+	LAYOUT_FIELD(FShaderResourceParameter, OrderClusterOutBufferSRV);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassWeightmap0);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassWeightmap1);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassWeightmapSampler);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassInstanceBufferUAV);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassInstanceCountUAV);
+};
+
+class FLandscapeGpuGrassDrawArgsCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FLandscapeGpuGrassDrawArgsCS);
+
+public:
+	FLandscapeGpuGrassDrawArgsCS() : FGlobalShader() {}
+
+	FLandscapeGpuGrassDrawArgsCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		GrassParameters.Bind(Initializer.ParameterMap, TEXT("GrassParameters"));
+		GrassDrawVarieties.Bind(Initializer.ParameterMap, TEXT("GrassDrawVarieties"));
+		GrassInstanceCountSRV.Bind(Initializer.ParameterMap, TEXT("GrassInstanceCountSRV"));
+		GrassDrawArgsUAV.Bind(Initializer.ParameterMap, TEXT("GrassDrawArgsUAV"));
+	}
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return true;
+	}
+
+	void BindParameters(FRHICommandList& RHICmdList, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData, const FUintVector4& PackConstBuffer) {
+		const FLandscapeGpuGrass_RenderThread& Grass = *RenderComponentData.Grass;
+
+		//See detailed definition in shader, four draws per vector
+		uint32 DrawVarieties[LandscapeGpuRenderParameter::GrassMaxDraws] = { 0 };
+		for (int32 DrawIndex = 0; DrawIndex < Grass.Draws.Num(); ++DrawIndex) {
+			DrawVarieties[DrawIndex] = Grass.Draws[DrawIndex].Variety;
+		}
+
+		//Barrier Batch
+		FRHITransitionInfo GpuGrassDrawArgsBarriers[] = {
+			FRHITransitionInfo(Grass.InstanceCount_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute), //RAW
+			FRHITransitionInfo(Grass.DrawArgs_GPU.UAV, ERHIAccess::IndirectArgs, ERHIAccess::UAVCompute), //WAR
+		};
+		RHICmdList.Transition(MakeArrayView(GpuGrassDrawArgsBarriers, UE_ARRAY_COUNT(GpuGrassDrawArgsBarriers)));
+
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassParameters, PackConstBuffer);
+		SetShaderValueArray(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassDrawVarieties, reinterpret_cast<const FUintVector4*>(DrawVarieties), LandscapeGpuRenderParameter::GrassMaxDraws / 4);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassInstanceCountSRV, Grass.InstanceCount_GPU.SRV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassDrawArgsUAV, Grass.DrawArgs_GPU.UAV);
+	}
+
+	void UnBindParameters(FRHICommandList& RHICmdList) {
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), GrassDrawArgsUAV, nullptr);
+	}
+
+private:
+	LAYOUT_FIELD(FShaderParameter, GrassParameters);
+	LAYOUT_FIELD(FShaderParameter, GrassDrawVarieties);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassInstanceCountSRV);
+	LAYOUT_FIELD(FShaderResourceParameter, GrassDrawArgsUAV);
+};
+
+class FLandscapeGpuOccluderCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FLandscapeGpuOccluderCS);
+
+public:
+	FLandscapeGpuOccluderCS() : FGlobalShader() {}
+
+	FLandscapeGpuOccluderCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		LandscapeGpuCullingLandscape.Bind(Initializer.ParameterMap, TEXT("LandscapeGpuCullingLandscape"));
+		OccluderViewProjectMatrix.Bind(Initializer.ParameterMap, TEXT("OccluderViewProjectMatrix"));
+		OccluderInvViewProjectMatrix.Bind(Initializer.ParameterMap, TEXT("OccluderInvViewProjectMatrix"));
+		OccluderParameters.Bind(Initializer.ParameterMap, TEXT("OccluderParameters"));
+		ClusterInputDataSRV.Bind(Initializer.ParameterMap, TEXT("ClusterInputDataSRV"));
+		ClusterOutBufferSRV.Bind(Initializer.ParameterMap, TEXT("ClusterOutBufferSRV"));
+		HzbResourceBufferUAV.Bind(Initializer.ParameterMap, TEXT("HzbResourceBufferUAV"));
+	}
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return true;
+	}
+
+	void BindParameters(FRHICommandList& RHICmdList, const FViewInfo& View, const FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponentData) {
+		//The quads are built and ray tested in landscape space, so the landscape may be rotated
+		const FVector4 OccluderPackConstBuffer = FVector4(RenderComponentData.WorldToLocal.TransformPosition(View.ViewMatrices.GetViewOrigin()), CVarMobileLandscapeEarlyOccluderMaxLod.GetValueOnRenderThread());
+
+		SetUniformBufferParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), LandscapeGpuCullingLandscape, RenderComponentData.CullingUniformBuffer);
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), OccluderViewProjectMatrix, RenderComponentData.LocalToWorld * View.ViewMatrices.GetViewProjectionMatrix());
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), OccluderInvViewProjectMatrix, View.ViewMatrices.GetInvViewProjectionMatrix() * RenderComponentData.WorldToLocal);
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), OccluderParameters, OccluderPackConstBuffer);
+
+		//ClusterOutputData_GPU is still SRVCompute since the sorted CS of last frame
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterInputDataSRV, RenderComponentData.ClusterInputData_GPU.SRV);
+		SetSRVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), ClusterOutBufferSRV, RenderComponentData.ClusterOutputData_GPU.SRV);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbResourceBufferUAV, GLandscapeOccluderHzb.GetBuffer().UAV);
+	}
+
+	void UnBindParameters(FRHICommandList& RHICmdList) {
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbResourceBufferUAV, nullptr);
+	}
+
+private:
+	LAYOUT_FIELD(FShaderUniformBufferParameter, LandscapeGpuCullingLandscape);
+	LAYOUT_FIELD(FShaderParameter, OccluderViewProjectMatrix);
+	LAYOUT_FIELD(FShaderParameter, OccluderInvViewProjectMatrix);
+	LAYOUT_FIELD(FShaderParameter, OccluderParameters);
+	LAYOUT_FIELD(FShaderResourceParameter, ClusterInputDataSRV);
+	LAYOUT_FIELD(FShaderResourceParameter, ClusterOutBufferSRV);
+	LAYOUT_FIELD(FShaderResourceParameter, HzbResourceBufferUAV);
+};
+
+class FLandscapeGpuHzbReduceCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FLandscapeGpuHzbReduceCS);
+
+public:
+	FLandscapeGpuHzbReduceCS() : FGlobalShader() {}
+
+	FLandscapeGpuHzbReduceCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		HzbReduceLevel.Bind(Initializer.ParameterMap, TEXT("HzbReduceLevel"));
+		HzbResourceBufferUAV.Bind(Initializer.ParameterMap, TEXT("HzbResourceBufferUAV"));
+	}
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return true;
+	}
+
+	void BindParameters(FRHICommandList& RHICmdList, uint32 Level) {
+		SetShaderValue(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbReduceLevel, Level);
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbResourceBufferUAV, GLandscapeOccluderHzb.GetBuffer().UAV);
+	}
+
+	void UnBindParameters(FRHICommandList& RHICmdList) {
+		SetUAVParameter(RHICmdList, RHICmdList.GetBoundComputeShader(), HzbResourceBufferUAV, nullptr);
+	}
+
+private:
+	LAYOUT_FIELD(FShaderParameter, HzbReduceLevel);
+	LAYOUT_FIELD(FShaderResourceParameter, HzbResourceBufferUAV);
 };
 
 IMPLEMENT_SHADER_TYPE(, FComputeLandscapeLodCS, TEXT("/Engine/Private/LandscapeGpuRender.usf"), TEXT("ClusterComputeLODCS"), SF_Compute)
 IMPLEMENT_SHADER_TYPE(, FLandscapeGpuCullingCS, TEXT("/Engine/Private/LandscapeGpuRender.usf"), TEXT("LandscapeGpuCullingCS"), SF_Compute)
 IMPLEMENT_SHADER_TYPE(, FLandscapeGpuSortedCS, TEXT("/Engine/Private/LandscapeGpuRender.usf"), TEXT("LandscapeGpuSortedCS"), SF_Compute)
+IMPLEMENT_SHADER_TYPE(, FLandscapeGpuOccluderCS, TEXT("/Engine/Private/LandscapeGpuRender.usf"), TEXT("LandscapeGpuOccluderCS"), SF_Compute)
+IMPLEMENT_SHADER_TYPE(, FLandscapeGpuHzbReduceCS, TEXT("/Engine/Private/LandscapeGpuRender.usf"), TEXT("LandscapeGpuHzbReduceCS"), SF_Compute)
+IMPLEMENT_SHADER_TYPE(, FLandscapeGpuGrassPrepareCS, TEXT("/Engine/Private/LandscapeGpuGrass.usf"), TEXT("LandscapeGpuGrassPrepareCS"), SF_Compute)
+IMPLEMENT_SHADER_TYPE(, FLandscapeGpuGrassGenerateCS, TEXT("/Engine/Private/LandscapeGpuGrass.usf"), TEXT("LandscapeGpuGrassGenerateCS"), SF_Compute)
+IMPLEMENT_SHADER_TYPE(, FLandscapeGpuGrassDrawArgsCS, TEXT("/Engine/Private/LandscapeGpuGrass.usf"), TEXT("LandscapeGpuGrassDrawArgsCS"), SF_Compute)
 
 void FMobileSceneRenderer::MobileGpuRenderLanscape(FRHICommandListImmediate& RHICmdList) {
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
@@ -199,15 +619,35 @@ void FMobileSceneRenderer::MobileGpuRenderLanscape(FRHICommandListImmediate& RHI
 #endif
 	FMobileLandscapeGPURenderSystem_RenderThread* LandscapeSystem = FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderSystem_RenderThread(Scene->GetWorld()->GetUniqueID());
 	if (LandscapeSystem) {
+		//Uploaded once for all the landscapes, each landscape keeps its own constants in CullingUniformBuffer
+		const TUniformBufferRef<FLandscapeGpuCullingViewParameters> CullingViewUniformBuffer = CreateLandscapeGpuCullingViewUniformBuffer(Views[0]);
+		const FLandscapeCullingHzb CullingHzb = FLandscapeCullingHzb::GetForView(Views[0]);
 		for (auto& ComponentPair : LandscapeSystem->LandscapeGpuRenderComponent_RenderThread) {
-			FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponent = ComponentPair.Value;
-			RenderComponent.UpdateAllGPUBuffer();
-			//Calculate All ClusterLod
+			FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponent = *ComponentPair.Value;
+			if (RenderComponent.UpdateAllGPUBuffer() && RenderComponent.SceneProxy) {
+				Scene->UpdateCachedRenderStates(RenderComponent.SceneProxy); //The draw commands are recached before ComputeViewVisibility uses them
+			}
+			if (!RenderComponent.IndirectDrawCommandBuffer_GPU.Buffer) {
+				continue; //The cluster bounds are still building
+			}
+			RenderComponent.ResolveLodHistogram();
+			RenderComponent.ResolveClusterInputReadback();
+			if (RenderComponent.VirtualHeightmap) {
+				RenderComponent.VirtualHeightmap->UpdatePages(RHICmdList); //Before the culling, which tests the page table
+			}
+			if (RenderComponent.HeightmapArray) {
+				RenderComponent.HeightmapArray->UpdateSlices(RHICmdList);
+			}
+			const uint32 NumDrawBuckets = RenderComponent.GetDrawBucketCount();
+			TShaderPermutationDomain<FLandscapeStitchingIndexBufferDim> PermutationVector;
+			PermutationVector.Set<FLandscapeStitchingIndexBufferDim>(RenderComponent.bStitchingIndexBuffer);
+
+			//Calculate All ClusterLod, and clear the count of every draw bucket
 			{
-				const uint32 ThreadGroups = FMath::DivideAndRoundUp(RenderComponent.NumRegisterComponent, ThreadCount);
-				TShaderMapRef<FComputeLandscapeLodCS> ComputeLandscapeLodCS(GetGlobalShaderMap(FeatureLevel));
+				const uint32 ThreadGroups = FMath::DivideAndRoundUp(FMath::Max(RenderComponent.NumRegisterComponent, NumDrawBuckets), ThreadCount);
+				TShaderMapRef<FComputeLandscapeLodCS> ComputeLandscapeLodCS(GetGlobalShaderMap(FeatureLevel), PermutationVector);
 				RHICmdList.SetComputeShader(ComputeLandscapeLodCS.GetComputeShader());
-				ComputeLandscapeLodCS->BindParameters(RHICmdList, Views[0], RenderComponent);
+				ComputeLandscapeLodCS->BindParameters(RHICmdList, CullingViewUniformBuffer, RenderComponent);
 				RHICmdList.DispatchComputeShader(ThreadGroups, 1, 1);
 				ComputeLandscapeLodCS->UnBindParameters(RHICmdList);
 			}
@@ -216,31 +656,192 @@ void FMobileSceneRenderer::MobileGpuRenderLanscape(FRHICommandListImmediate& RHI
 			{
 				const uint32 ThreadGroupsX = FMath::DivideAndRoundUp(RenderComponent.ClusterSizeX, ThreadCount_1);
 				const uint32 ThreadGroupsY = FMath::DivideAndRoundUp(RenderComponent.ClusterSizeY, ThreadCount_1);
-				TShaderMapRef<FLandscapeGpuCullingCS> LandscapeGpuCullingCS(GetGlobalShaderMap(FeatureLevel));
+				FLandscapeGpuCullingCS::FPermutationDomain CullingPermutationVector;
+				CullingPermutationVector.Set<FLandscapeStitchingIndexBufferDim>(RenderComponent.bStitchingIndexBuffer);
+				CullingPermutationVector.Set<FLandscapeVirtualHeightmapDim>(RenderComponent.VirtualHeightmap != nullptr);
+				CullingPermutationVector.Set<FLandscapeVirtualTexturePageDim>(false);
+				TShaderMapRef<FLandscapeGpuCullingCS> LandscapeGpuCullingCS(GetGlobalShaderMap(FeatureLevel), CullingPermutationVector);
 				RHICmdList.SetComputeShader(LandscapeGpuCullingCS.GetComputeShader());
-				LandscapeGpuCullingCS->BindParameters(RHICmdList, Views[0], RenderComponent);
+				LandscapeGpuCullingCS->BindParameters(RHICmdList, CullingViewUniformBuffer, CullingHzb, RenderComponent);
 				RHICmdList.DispatchComputeShader(ThreadGroupsX, ThreadGroupsY, 1);
 				LandscapeGpuCullingCS->UnBindParameters(RHICmdList);
+				RenderComponent.bClusterOutputHistoryValid = true;
 			}
 
 			//Write DrawCommand and arrange ClusterOutBufferUAV
 			{
-				const uint32 ThreadGroups = FMath::DivideAndRoundUp(RenderComponent.ClusterSizeX * RenderComponent.ClusterSizeY, ThreadCount);
-				TShaderMapRef<FLandscapeGpuSortedCS> LandscapeGpuSortedCS(GetGlobalShaderMap(FeatureLevel));
+				const uint32 ThreadGroups = FMath::DivideAndRoundUp(FMath::Max(RenderComponent.ClusterSizeX * RenderComponent.ClusterSizeY, RenderComponent.GetIndirectDrawCount()), ThreadCount);
+				TShaderMapRef<FLandscapeGpuSortedCS> LandscapeGpuSortedCS(GetGlobalShaderMap(FeatureLevel), PermutationVector);
 				RHICmdList.SetComputeShader(LandscapeGpuSortedCS.GetComputeShader());
-				LandscapeGpuSortedCS->BindParameters(RHICmdList, Views[0], RenderComponent);
+				LandscapeGpuSortedCS->BindParameters(RHICmdList, RenderComponent, FLandscapeClusterCullingOutput::GetMainView(RenderComponent));
 				RHICmdList.DispatchComputeShader(ThreadGroups, 1, 1);
 				LandscapeGpuSortedCS->UnBindParameters(RHICmdList);
 			}
 
+			//Spawn the grass inside the visible Lod0 and Lod1 clusters, they are the first clusters of the ordered cluster buffer
+			const bool bGrass = RenderComponent.Grass && RenderComponent.LandscapeGpuRenderUserData.LandscapeGpuRenderUniformBuffer;
+			if (bGrass) {
+				FLandscapeGpuGrass_RenderThread& Grass = *RenderComponent.Grass;
+				const FUintVector4 GrassPackConstBuffer = FUintVector4(
+					Grass.Varieties.Num(),
+					Grass.MaxInstancesPerVariety,
+					LandscapeGpuRenderParameter::GetGrassDrawBucketCount(RenderComponent.bStitchingIndexBuffer),
+					Grass.Draws.Num()
+				);
+				RHICmdList.Transition(FRHITransitionInfo(RenderComponent.OrderClusterOutBufferUAV_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute)); //RAW
+
+				TShaderMapRef<FLandscapeGpuGrassPrepareCS> LandscapeGpuGrassPrepareCS(GetGlobalShaderMap(FeatureLevel));
+				RHICmdList.SetComputeShader(LandscapeGpuGrassPrepareCS.GetComputeShader());
+				LandscapeGpuGrassPrepareCS->BindParameters(RHICmdList, RenderComponent, GrassPackConstBuffer);
+				RHICmdList.DispatchComputeShader(1, 1, 1);
+				LandscapeGpuGrassPrepareCS->UnBindParameters(RHICmdList);
+
+				TShaderMapRef<FLandscapeGpuGrassGenerateCS> LandscapeGpuGrassGenerateCS(GetGlobalShaderMap(FeatureLevel));
+				RHICmdList.SetComputeShader(LandscapeGpuGrassGenerateCS.GetComputeShader());
+				LandscapeGpuGrassGenerateCS->BindParameters(RHICmdList, RenderComponent, GrassPackConstBuffer);
+				RHICmdList.DispatchIndirectComputeShader(Grass.DispatchArgs_GPU.Buffer, 0);
+				LandscapeGpuGrassGenerateCS->UnBindParameters(RHICmdList);
+
+				TShaderMapRef<FLandscapeGpuGrassDrawArgsCS> LandscapeGpuGrassDrawArgsCS(GetGlobalShaderMap(FeatureLevel));
+				RHICmdList.SetComputeShader(LandscapeGpuGrassDrawArgsCS.GetComputeShader());
+				LandscapeGpuGrassDrawArgsCS->BindParameters(RHICmdList, RenderComponent, GrassPackConstBuffer);
+				RHICmdList.DispatchComputeShader(1, 1, 1);
+				LandscapeGpuGrassDrawArgsCS->UnBindParameters(RHICmdList);
+
+				FRHITransitionInfo GpuGrassSubmitBarriers[] = {
+					FRHITransitionInfo(Grass.DrawArgs_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::IndirectArgs), //RAW
+					FRHITransitionInfo(Grass.InstanceBuffer.UAV, ERHIAccess::UAVCompute, ERHIAccess::VertexOrIndexBuffer), //RAW
+				};
+				RHICmdList.Transition(MakeArrayView(GpuGrassSubmitBarriers, UE_ARRAY_COUNT(GpuGrassSubmitBarriers)));
+			}
+
+			//The Lod histogram feeds the heightmap streaming
+			RenderComponent.EnqueueLodHistogramReadback(RHICmdList);
+			RenderComponent.EnqueueClusterInputReadback(RHICmdList); //Just if the bounds debug draw asked for it
+			if (RenderComponent.VirtualHeightmap) {
+				RenderComponent.VirtualHeightmap->EnqueuePageRequestReadback(RHICmdList);
+			}
+
 			//Submit to Graphics
 			{
 				FRHITransitionInfo UpdateIndirectBufferPassBarriers[] = {
 					FRHITransitionInfo(RenderComponent.IndirectDrawCommandBuffer_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::IndirectArgs), //RAW
-					FRHITransitionInfo(RenderComponent.OrderClusterOutBufferUAV_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVGraphics), //RAW
+					FRHITransitionInfo(RenderComponent.OrderClusterOutBufferUAV_GPU.UAV, bGrass ? ERHIAccess::SRVCompute : ERHIAccess::UAVCompute, ERHIAccess::SRVGraphics), //RAW
 					//FRHITransitionInfo(RenderComponent.ClusterLodCountUAV_GPU.UAV, ERHIAccess::SRVCompute, ERHIAccess::SRVGraphics) //RAR... just need StageMask
 				};
 				RHICmdList.Transition(MakeArrayView(UpdateIndirectBufferPassBarriers, UE_ARRAY_COUNT(UpdateIndirectBufferPassBarriers)));
+				if (RenderComponent.bStitchingIndexBuffer) {
+					RHICmdList.Transition(FRHITransitionInfo(RenderComponent.DrawBucketStart_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVGraphics)); //RAW
+				}
+			}
+		}
+	}
+}
+
+void FMobileSceneRenderer::MobileRenderLandscapeOccluders(FRHICommandListImmediate& RHICmdList) {
+	SCOPED_DRAW_EVENT(RHICmdList, LandscapeEarlyOccluders);
+
+	//Rebuilt even without landscape, the mobile Hzb of last frame is left to MobileGPUCulling
+	FRHIUnorderedAccessView* HzbUAV = GLandscapeOccluderHzb.GetBuffer().UAV;
+	RHICmdList.Transition(FRHITransitionInfo(HzbUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute)); //SRVCompute since last frame's culling, or never used
+	RHICmdList.ClearUAVUint(HzbUAV, FUintVector4(0, 0, 0, 0)); //Far plane, nothing is occluded
+	RHICmdList.Transition(FRHITransitionInfo(HzbUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute)); //WAW
+
+	const FViewInfo& View = Views[0];
+	FMobileLandscapeGPURenderSystem_RenderThread* LandscapeSystem = FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderSystem_RenderThread(Scene->GetWorld()->GetUniqueID());
+	if (LandscapeSystem) {
+		TShaderMapRef<FLandscapeGpuOccluderCS> LandscapeGpuOccluderCS(GetGlobalShaderMap(FeatureLevel));
+		for (auto& ComponentPair : LandscapeSystem->LandscapeGpuRenderComponent_RenderThread) {
+			FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponent = *ComponentPair.Value;
+			if (!RenderComponent.bClusterOutputHistoryValid) {
+				continue;
+			}
+
+			//One group per cluster, the occluders of all the landscapes are merged by InterlockedMax
+			RHICmdList.SetComputeShader(LandscapeGpuOccluderCS.GetComputeShader());
+			LandscapeGpuOccluderCS->BindParameters(RHICmdList, View, RenderComponent);
+			RHICmdList.DispatchComputeShader(RenderComponent.ClusterSizeX, RenderComponent.ClusterSizeY, 1);
+			LandscapeGpuOccluderCS->UnBindParameters(RHICmdList);
+			RHICmdList.Transition(FRHITransitionInfo(HzbUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute)); //WAW
+		}
+	}
+
+	//Build the mips, the culling CS moves the Hzb to SRVCompute
+	TShaderMapRef<FLandscapeGpuHzbReduceCS> LandscapeGpuHzbReduceCS(GetGlobalShaderMap(FeatureLevel));
+	RHICmdList.SetComputeShader(LandscapeGpuHzbReduceCS.GetComputeShader());
+	for (uint32 Level = 1; Level < HzbMipCount; ++Level) {
+		LandscapeGpuHzbReduceCS->BindParameters(RHICmdList, Level);
+		RHICmdList.DispatchComputeShader(FMath::DivideAndRoundUp(HzbSizeX >> Level, ThreadCount_1), FMath::DivideAndRoundUp(HzbSizeY >> Level, ThreadCount_1), 1);
+		RHICmdList.Transition(FRHITransitionInfo(HzbUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute)); //RAW
+	}
+	LandscapeGpuHzbReduceCS->UnBindParameters(RHICmdList);
+}
+
+void CullLandscapeGpuVirtualTexturePage(FRHICommandListImmediate& RHICmdList, const FScene* Scene, const FMatrix& PageViewProjectionMatrix, float PageTexelWorldSize) {
+	FMobileLandscapeGPURenderSystem_RenderThread* LandscapeSystem = FMobileLandscapeGPURenderSystem_RenderThread::GetLandscapeGPURenderSystem_RenderThread(Scene->GetWorld()->GetUniqueID());
+	if (!LandscapeSystem) {
+		return;
+	}
+
+	FConvexVolume PageFrustum;
+	GetViewFrustumBounds(PageFrustum, PageViewProjectionMatrix, false);
+	if (PageFrustum.PermutedPlanes.Num() != 8) {
+		return;
+	}
+
+	const ERHIFeatureLevel::Type FeatureLevel = Scene->GetFeatureLevel();
+	for (auto& ComponentPair : LandscapeSystem->LandscapeGpuRenderComponent_RenderThread) {
+		FLandscapeGpuRenderProxyComponent_RenderThread& RenderComponent = *ComponentPair.Value;
+		if (!RenderComponent.bVirtualTexture || !RenderComponent.VirtualTextureIndirectDrawCommandBuffer_GPU.Buffer || !RenderComponent.SceneProxy) {
+			continue;
+		}
+
+		const FLandscapeClusterCullingOutput CullingOutput = FLandscapeClusterCullingOutput::GetVirtualTexture(RenderComponent);
+		const uint32 PageLod = LandscapeGpuRenderParameter::GetVirtualTextureLod(PageTexelWorldSize, RenderComponent.SceneProxy->GetLocalToWorld().GetScaleVector().X);
+
+		//No Lod pass for the page, just clear the count of every draw bucket
+		RHICmdList.Transition(FRHITransitionInfo(CullingOutput.ClusterLodCount.UAV, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute)); //WAR
+		RHICmdList.ClearUAVUint(CullingOutput.ClusterLodCount.UAV, FUintVector4(0, 0, 0, 0));
+
+		//Culling against the page frustum, PackData, CalculateLodCount
+		{
+			const uint32 ThreadGroupsX = FMath::DivideAndRoundUp(RenderComponent.ClusterSizeX, ThreadCount_1);
+			const uint32 ThreadGroupsY = FMath::DivideAndRoundUp(RenderComponent.ClusterSizeY, ThreadCount_1);
+			FLandscapeGpuCullingCS::FPermutationDomain CullingPermutationVector;
+			CullingPermutationVector.Set<FLandscapeStitchingIndexBufferDim>(RenderComponent.bStitchingIndexBuffer);
+			CullingPermutationVector.Set<FLandscapeVirtualHeightmapDim>(RenderComponent.VirtualHeightmap != nullptr);
+			CullingPermutationVector.Set<FLandscapeVirtualTexturePageDim>(true);
+			TShaderMapRef<FLandscapeGpuCullingCS> LandscapeGpuCullingCS(GetGlobalShaderMap(FeatureLevel), CullingPermutationVector);
+			RHICmdList.SetComputeShader(LandscapeGpuCullingCS.GetComputeShader());
+			LandscapeGpuCullingCS->BindVirtualTexturePageParameters(RHICmdList, PageFrustum, PageLod, RenderComponent);
+			RHICmdList.DispatchComputeShader(ThreadGroupsX, ThreadGroupsY, 1);
+			LandscapeGpuCullingCS->UnBindParameters(RHICmdList);
+			if (RenderComponent.VirtualHeightmap) {
+				RHICmdList.Transition(FRHITransitionInfo(RenderComponent.VirtualHeightmap->PageRequest_GPU.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute)); //Read back with the next main view
+			}
+		}
+
+		//Write DrawCommand and arrange the page ClusterOutBuffer
+		{
+			const uint32 ThreadGroups = FMath::DivideAndRoundUp(FMath::Max(RenderComponent.ClusterSizeX * RenderComponent.ClusterSizeY, RenderComponent.GetIndirectDrawCount()), ThreadCount);
+			TShaderPermutationDomain<FLandscapeStitchingIndexBufferDim> PermutationVector;
+			PermutationVector.Set<FLandscapeStitchingIndexBufferDim>(RenderComponent.bStitchingIndexBuffer);
+			TShaderMapRef<FLandscapeGpuSortedCS> LandscapeGpuSortedCS(GetGlobalShaderMap(FeatureLevel), PermutationVector);
+			RHICmdList.SetComputeShader(LandscapeGpuSortedCS.GetComputeShader());
+			LandscapeGpuSortedCS->BindParameters(RHICmdList, RenderComponent, CullingOutput);
+			RHICmdList.DispatchComputeShader(ThreadGroups, 1, 1);
+			LandscapeGpuSortedCS->UnBindParameters(RHICmdList);
+		}
+
+		//Submit to the page draw
+		{
+			FRHITransitionInfo UpdateIndirectBufferPassBarriers[] = {
+				FRHITransitionInfo(CullingOutput.IndirectDrawCommandBuffer.UAV, ERHIAccess::UAVCompute, ERHIAccess::IndirectArgs), //RAW
+				FRHITransitionInfo(CullingOutput.OrderClusterOutBuffer.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVGraphics), //RAW
+			};
+			RHICmdList.Transition(MakeArrayView(UpdateIndirectBufferPassBarriers, UE_ARRAY_COUNT(UpdateIndirectBufferPassBarriers)));
+			if (RenderComponent.bStitchingIndexBuffer) {
+				RHICmdList.Transition(FRHITransitionInfo(CullingOutput.DrawBucketStart.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVGraphics)); //RAW
 			}
 		}
 	}
@@ -248,4 +849,12 @@ void FMobileSceneRenderer::MobileGpuRenderLanscape(FRHICommandListImmediate& RHI
 
 bool bUseLandscapeGpuDriven(const FViewInfo& View) {
 	return CVarMobileLandscapeGpuRender.GetValueOnRenderThread() != 0 && !View.bIsSceneCapture;
+}
+
+bool bUseLandscapeEarlyOccluder(const FViewInfo& View) {
+	return bUseLandscapeGpuDriven(View) && CVarMobileLandscapeEarlyOccluder.GetValueOnRenderThread() != 0;
+}
+
+FMatrix GetLandscapeHzbViewProjectionMatrix(const FViewInfo& View) {
+	return bUseLandscapeEarlyOccluder(View) ? View.ViewMatrices.GetViewProjectionMatrix() : View.PrevViewInfo.ViewMatrices.GetViewProjectionMatrix();
 }
\ No newline at end of file
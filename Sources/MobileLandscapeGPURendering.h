@@ -2,4 +2,15 @@
 
 class FViewInfo;
 
-bool bUseLandscapeGpuDriven(const FViewInfo& View);
\ No newline at end of file
+bool bUseLandscapeGpuDriven(const FViewInfo& View);
+
+//The landscape culling reads an Hzb built from the near landscape clusters, see CVarMobileLandscapeEarlyOccluder
+bool bUseLandscapeEarlyOccluder(const FViewInfo& View);
+
+//The view of the Hzb read by the landscape culling, this frame's one with the early landscape occluders, else last frame's one of the mobile Hzb
+FMatrix GetLandscapeHzbViewProjectionMatrix(const FViewInfo& View);
+class FScene;
+class FRHICommandListImmediate;
+
+//Cull the GPU landscapes against the ortho frustum of one runtime virtual texture page, call it before the page draws its meshes
+void CullLandscapeGpuVirtualTexturePage(FRHICommandListImmediate& RHICmdList, const FScene* Scene, const FMatrix& PageViewProjectionMatrix, float PageTexelWorldSize);
@@ -59,6 +59,9 @@
 #include "MobileHZB.h"
 #include "MobileGPUDrivenRendering.h"
 //@StarLight code - END GPU-Driven, Added by yanjianhong
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+#include "MobileLandscapeGPURendering.h"
+//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 
 uint32 GetShadowQuality();
 
@@ -306,6 +309,11 @@ void FMobileSceneRenderer::InitViews(FRHICommandListImmediate& RHICmdList)
 	//@StarLight code - BEGIN GPU-Driven, Added by yanjianhong
 	if (bUseMobileGpuDriven(Views[0])) {
 		FMobileHzbSystem::InitialResource();
+		//@StarLight code - LandscapeGpuRender, Added by yanjianhong
+		if (bUseLandscapeEarlyOccluder(Views[0])) {
+			MobileRenderLandscapeOccluders(RHICmdList);
+		}
+		//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 		MobileGPUCulling(RHICmdList);
 	}
 	//@StarLight code - END GPU-Driven, Added by yanjianhong
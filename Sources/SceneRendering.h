@@ -2032,6 +2032,7 @@ protected:
 
 	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 	void MobileGpuRenderLanscape(FRHICommandListImmediate& RHICmdList);
+	void MobileRenderLandscapeOccluders(FRHICommandListImmediate& RHICmdList);
 	//@StarLight code - LandscapeGpuRender, Added by yanjianhong
 
 	void InitViews(FRHICommandListImmediate& RHICmdList);